@@ -2,7 +2,6 @@
 
 
 #define MAX_SEQUENCE_NUM 7
-#define MAX_WINDOW_SIZE 10
 
 
 // ***************************************************************************
@@ -28,13 +27,54 @@ struct pkt ackPacket;
 struct pkt sentPackets[MAX_WINDOW_SIZE];
 struct pkt unAckPacks[MAX_WINDOW_SIZE]; //store unacknowledged packets
 
-float packetStartTimes[MAX_WINDOW_SIZE];
+simtime packetStartTimes[MAX_WINDOW_SIZE]; //in simulator ticks
+bool retransmitted[MAX_WINDOW_SIZE]; //sent more than once, so no RTT sample
+
+// Message aggregation: with aggregateLimit above one, messages from the
+// application are held back and sent together once aggregateLimit of them
+// are waiting or aggregateDelay has passed since the first one arrived.
+int aggregateLimit = 1;
+float aggregateDelay = 0;
+struct msg pendingMessages[MAX_PAYLOAD / sizeof(msg::data)];
+int pendingCount = 0;
+bool flushDue = false; //pending messages are waiting only for the window to open
+bool flushTimerRunning = false;
+
+// Forward error correction: with fecGroupSize above zero, every group of
+// fecGroupSize packets (seqnums 1..k, k+1..2k, ...) is followed by a parity
+// packet, the XOR of their payloads.  The seqnums in a group are consecutive
+// and data packets from A always carry acknum 0, so the parity packet only
+// has to name its group (seqnum = first seqnum in the group) and carry the
+// XOR of the lengths, which it does in a negative acknum: -1 - xor.
+// To have the rest of a group at hand for the XOR, B keeps the good
+// packets of the group it is waiting on even when they arrive out of
+// order, and delivers them once the gap is filled.  Within a group that
+// makes B a selective repeat receiver, so packets delivered from that
+// buffer are counted apart from the ones rebuilt from parity.
+int fecGroupSize = 0;
+long fecParitySent = 0;
+long fecDataSent = 0;
+long fecRecovered = 0;
+long fecBuffered = 0;
+
+// Congestion control: with a controller, its congestion window replaces
+// the fixed window N.  After a timeout only the packets that fit in the
+// (now smaller) window are resent; resendNext is the first one still
+// waiting, and the rest follow as ACKs open the window again.
+congestion_control *congestion = nullptr;
+int resendNext = 1;
+simtime lastTimeout = 0; //packets sent before it waited out the timeout
 
 void A_init() {
 	base = 1;
 	nextSequenceNum = 1;
+	resendNext = 1;
+	lastTimeout = 0;
 	timerValue = 100;
 	windowSize = 10;
+	pendingCount = 0;
+	flushDue = false;
+	flushTimerRunning = false;
 
 	for (int i = 0; i < MAX_WINDOW_SIZE; i++) {
 		unAckPacks[i].seqnum = -1; //invalid seq num
@@ -54,39 +94,92 @@ int acknowledgementFlag = 0;
 int maxPacketBufferSize = 0;
 int senderWindow = 10;
 
+int groupFirst = 1; //first seqnum of the group expectedSequenceNum is in
+struct pkt groupPackets[MAX_FEC_GROUP];
+bool groupHave[MAX_FEC_GROUP];
+int groupRebuilt = -1; //seqnum of the packet rebuilt from parity, if any
+
 void B_init() {
 	expectedSequenceNum = 1;
+	groupFirst = 1;
+	groupRebuilt = -1;
+	for (int i = 0; i < MAX_FEC_GROUP; i++) {
+		groupHave[i] = false;
+	}
 }
 
-int inputChecksum(struct pkt packet) {
-	int checksum = 0;
+// Largest payload a packet can carry, depending on where its bytes are.
+int max_length(const struct pkt& packet) {
+	return packet.data != nullptr ? MAX_SEGMENT : MAX_PAYLOAD;
+}
 
+// Fletcher style checksum over the payload: a plain byte sum can't tell a
+// packet of mixed messages from one overwritten with a single repeated byte.
+// The sums are reduced every 5552 bytes, the longest run that can't overflow
+// sum2 when both sums carry up to 65534 from the block before.
+int inputChecksum(const struct pkt& packet) {
+	unsigned int sum1 = 0;
+	unsigned int sum2 = 0;
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(pkt_bytes(packet));
+	int length = std::min(packet.length, max_length(packet));
+
+	while (length > 0) {
+		int block = std::min(length, 5552);
+		for (int i = 0; i < block; i++) {
+			sum1 += bytes[i];
+			sum2 += sum1;
+		}
+		sum1 %= 65535;
+		sum2 %= 65535;
+		bytes += block;
+		length -= block;
+	}
+
+	unsigned int checksum = (sum2 << 16) | sum1;
 	checksum += packet.seqnum;
 	checksum += packet.acknum;
+	checksum += packet.length;
 
-	for (int i = 0; i < sizeof(packet.payload); i++) {
-		checksum += static_cast<unsigned char>(packet.payload[i]);
-	}
-
-	return checksum;
+	return static_cast<int>(checksum);
 }
 
 struct pkt make_pkt(int sequenceNumber, const char data[20], int ackNumber, int checksum) {
 	struct pkt packet;
 	packet.seqnum = sequenceNumber;
 	packet.acknum = ackNumber;
+	packet.data = nullptr;
 	if (data != nullptr) {
-		strncpy(packet.payload, data, sizeof(packet.payload));
+		memcpy(packet.payload, data, sizeof(msg::data));
+		packet.length = sizeof(msg::data);
 		packet.checksum = inputChecksum(packet);
 	} else {
 		memset(packet.payload, 0, sizeof(packet.payload));
+		packet.length = 0;
 		packet.checksum = checksum;
 	}
 	
 	return packet;
 }
 
+// A packet carrying length bytes at data, which must stay put until the
+// packet is acknowledged.  Nothing is copied.
+struct pkt make_segment(int sequenceNumber, const char *data, int length) {
+	struct pkt packet = make_pkt(sequenceNumber, nullptr, 0, 0);
+	packet.data = data;
+	packet.length = length;
+	packet.checksum = inputChecksum(packet);
+	return packet;
+}
+
+struct pkt make_ack(int ackNumber) {
+	static const char ackData[sizeof(msg::data)] = "ACK";
+	return make_pkt(0, ackData, ackNumber, 0);
+}
+
 bool is_corrupt(struct pkt packet) {
+	if (packet.length < 0 || packet.length > max_length(packet)) {
+		return true;
+	}
 
 	int calculated_checksum = inputChecksum(packet);
 	return packet.checksum != calculated_checksum;
@@ -104,18 +197,148 @@ bool if_corrupt(struct pkt packet) {
 	return is_corrupt(packet);
 }
 
-void extract(const struct pkt& packet, struct msg& message) {
-	strncpy(message.data, packet.payload, sizeof(message.data));
+void extract(const struct pkt& packet, struct msg& message, int index) {
+	memcpy(message.data, packet.payload + index * sizeof(message.data), sizeof(message.data));
+}
+
+// RTT estimates are kept in simulator ticks.  With alpha = 1/8 the moving
+// average needs only integer arithmetic.
+simtime EstimatedRTT = 0;
+const int alphaShift = 3;
+simtime SampleRTT = 0;
+
+// Retransmission timeout: never shorter than the initial timer value, but
+// allowed to grow when the measured round trip gets longer than that.  Only
+// the RTT-derived part is capped at maxTimerValue time units, so a small cap
+// can't shorten the initial timer.  The doubling is checked against the
+// limit first so a huge estimate can't overflow the tick count.
+float maxTimerValue = 1000;
+
+simtime timeoutInterval() {
+	simtime maxTimeout = simulator::ticks(maxTimerValue);
+	simtime rto = (EstimatedRTT > maxTimeout / 2) ? maxTimeout : 2 * EstimatedRTT;
+	return std::max(simulator::ticks(timerValue), rto);
 }
 
-float EstimatedRTT = 0.0;
-const float alpha = 0.125;
-float SampleRTT = 0.0;
+// Number of packets the sender may have in flight.
+int send_window() {
+	return congestion != nullptr ? congestion->window() : N;
+}
 
 void refuse_data(const char data[20]) {
 	INFO << "Window is full. Can't send more Data: " << data << ENDL;
 }
 
+// XOR of the payloads in the group starting at first, from sentPackets.
+struct pkt make_parity(int first) {
+	struct pkt parity = make_pkt(first, nullptr, 0, 0);
+	int lengths = 0;
+
+	for (int seqnum = first; seqnum < first + fecGroupSize; seqnum++) {
+		const struct pkt &packet = sentPackets[seqnum % MAX_WINDOW_SIZE];
+		for (int i = 0; i < packet.length; i++) {
+			parity.payload[i] ^= packet.payload[i];
+		}
+		parity.length = std::max(parity.length, packet.length);
+		lengths ^= packet.length;
+	}
+	parity.acknum = -1 - lengths;
+	parity.checksum = inputChecksum(parity);
+	return parity;
+}
+
+// Puts a packet in the window and sends it.  The caller checks there is room.
+void send_packet(struct pkt packet) {
+	int index = nextSequenceNum % MAX_WINDOW_SIZE;
+
+	sentPackets[index] = packet;
+
+	packetStartTimes[index] = simulation->getSimulatorTicks();
+	retransmitted[index] = false;
+
+	// The last packet of a group goes out together with the group's parity.
+	struct pkt burst[2] = {packet};
+	int count = 1;
+	if (fecGroupSize > 0 && packet.seqnum % fecGroupSize == 0) {
+		burst[count++] = make_parity(packet.seqnum - fecGroupSize + 1);
+		fecParitySent++;
+	}
+	fecDataSent++;
+	simulation->udt_send_burst(A, burst, count);
+
+	if (base == nextSequenceNum) {
+		simulation->start_timer_ticks(A, simulator::ticks(timerValue));
+	}
+
+	nextSequenceNum++;
+	resendNext = nextSequenceNum; //nothing before it is waiting to be resent
+}
+
+// Goes back: resends the packets from resendNext on that fit in the window.
+void resend_window() {
+	struct pkt burst[MAX_WINDOW_SIZE];
+	int count = 0;
+
+	while (resendNext < nextSequenceNum && resendNext < base + send_window()) {
+		int index = resendNext % MAX_WINDOW_SIZE;
+		if (sentPackets[index].seqnum != -1) {
+			burst[count++] = sentPackets[index];
+			packetStartTimes[index] = simulation->getSimulatorTicks();
+			retransmitted[index] = true;
+		}
+		resendNext++;
+	}
+	simulation->udt_send_burst(A, burst, count);
+}
+
+// Sends the pending messages as one packet, or leaves them for rdt_rcvA
+// to send if the window is full.
+void flush_pending() {
+	if (pendingCount == 0) {
+		return;
+	}
+	if (nextSequenceNum >= base + send_window()) {
+		flushDue = true;
+		return;
+	}
+
+	struct pkt packet = make_pkt(nextSequenceNum, nullptr, 0, 0);
+	for (int i = 0; i < pendingCount; i++) {
+		memcpy(packet.payload + packet.length, pendingMessages[i].data, sizeof(msg::data));
+		packet.length += sizeof(msg::data);
+	}
+	packet.checksum = inputChecksum(packet);
+
+	DEBUG << "FLUSH_PENDING: sending " << pendingCount << " messages in packet " << nextSequenceNum << ENDL;
+	send_packet(packet);
+
+	pendingCount = 0;
+	flushDue = false;
+	if (flushTimerRunning) {
+		simulation->stop_timer(A, FLUSH_INTERRUPT);
+		flushTimerRunning = false;
+	}
+}
+
+// Adds a message to the pending packet.  Refused only when the pending
+// packet is full and the window has no room to send it.
+bool aggregate(struct msg message) {
+	if (pendingCount == aggregateLimit) {
+		refuse_data(message.data);
+		return false;
+	}
+
+	pendingMessages[pendingCount++] = message;
+	if (pendingCount == 1 && aggregateDelay > 0) {
+		simulation->start_timer_ticks(A, simulator::ticks(aggregateDelay), FLUSH_INTERRUPT);
+		flushTimerRunning = true;
+	}
+	if (pendingCount == aggregateLimit || aggregateDelay <= 0) {
+		flush_pending();
+	}
+	return true;
+}
+
 // ***************************************************************************
 // * Called from layer 5, passed the data to be sent to other side 
 // ***************************************************************************
@@ -125,25 +348,15 @@ bool rdt_sendA(struct msg message) {
 		
 	INFO << "INFO: TOLAYER3 (" << simulation->getSimulatorClock() << "): " << "1 packets in flight to side B (" << nextSequenceNum << ", " << nextSequenceNum << ", " << inputChecksum(sentPackets[nextSequenceNum % MAX_WINDOW_SIZE]) << ") " << message.data << ENDL;
 
-	if (nextSequenceNum < base + N) {
+	if (aggregateLimit > 1) {
+		return aggregate(message);
+	}
+
+	if (nextSequenceNum < base + send_window()) {
 		//create a packet
 		struct pkt packet = make_pkt(nextSequenceNum, message.data, 0, 0);
-		
-		int index = nextSequenceNum % MAX_WINDOW_SIZE;
-		
-		sentPackets[index] = packet;
-
-		packetStartTimes[index] = simulation->getSimulatorClock();
-
-		packet.checksum = inputChecksum(packet);
-
-		simulation->udt_send(A,packet);
 
-		if (base == nextSequenceNum) {
-			simulation->start_timer(A, static_cast<float> (timerValue));
-		}
-
-		nextSequenceNum++;
+		send_packet(packet);
 		return true;
 	} else {
 		refuse_data(message.data);
@@ -153,27 +366,62 @@ bool rdt_sendA(struct msg message) {
 }
 
 
+// ***************************************************************************
+// * Called from layer 5 in file transfer mode, passed a segment of the file.
+// * The packet points at the segment, which stays mapped for the whole run.
+// ***************************************************************************
+bool rdt_send_segmentA(const char *data, int length) {
+	if (nextSequenceNum < base + send_window()) {
+		send_packet(make_segment(nextSequenceNum, data, length));
+		return true;
+	}
+	INFO << "Window is full. Can't send segment of " << length << " bytes" << ENDL;
+	return false;
+}
 
 // ***************************************************************************
 // * Called from layer 3, when a packet arrives for layer 4 on side A
 // ***************************************************************************
 void rdt_rcvA(struct pkt packet) {
-	if (!is_corrupt(packet)) {
+	if (!is_corrupt(packet) && get_acknum(packet) >= base) {
+
+		// Karn's rule: the ACK of a retransmitted packet could answer any of
+		// its copies, so only packets sent once give a round trip sample.
+		// With a congestion window, packets that weren't resent after a
+		// timeout can still be ACKed later, but their wait includes the
+		// timeout, so they don't count either.
+		int ackPacketIndex = packet.acknum % MAX_WINDOW_SIZE;
+		SampleRTT = 0;
+		if (!retransmitted[ackPacketIndex] && packetStartTimes[ackPacketIndex] >= lastTimeout) {
+			simtime finalTime = simulation->getSimulatorTicks();
+			simtime start_time = packetStartTimes[ackPacketIndex];
+			SampleRTT = finalTime - start_time;
+
+			EstimatedRTT += (SampleRTT - EstimatedRTT) / (1 << alphaShift);
+		}
+
+		if (congestion != nullptr) {
+			congestion->on_ack(simulation->getSimulatorClock(), get_acknum(packet) + 1 - base, simulator::units(SampleRTT));
+		}
 
 		base = get_acknum(packet) + 1;
+		resendNext = std::max(resendNext, base);
 
-		if (base == nextSequenceNum) {
-			simulation->stop_timer(A);
-		} else {
-			simulation->start_timer(A, EstimatedRTT);
+		// The oldest unacknowledged packet changed, so restart the timer for it.
+		simulation->stop_timer(A);
+		if (base != nextSequenceNum) {
+			simulation->start_timer_ticks(A, timeoutInterval());
+		}
+
+		// Packets left over from the last timeout go out as the window opens.
+		if (congestion != nullptr) {
+			resend_window();
 		}
-		
-		int ackPacketIndex = packet.acknum % MAX_WINDOW_SIZE;
-		float finalTime = simulation->getSimulatorClock();
-		float start_time = packetStartTimes[ackPacketIndex];
-		SampleRTT = finalTime - start_time;
 
-		EstimatedRTT = (1 - alpha) * EstimatedRTT + alpha * SampleRTT;
+		// The window has room again for messages that were waiting on it.
+		if (pendingCount > 0 && (flushDue || pendingCount == aggregateLimit)) {
+			flush_pending();
+		}
 	}
 }
 
@@ -190,22 +438,121 @@ bool rdt_sendB(struct msg message) {
 }
 
 
+// Hands every message in a packet to the application.
+void deliver_messages(const struct pkt& packet) {
+	if (packet.data != nullptr) {
+		simulation->deliver_segment(B, packet.data, packet.length);
+		return;
+	}
+	struct msg message;
+	for (int i = 0; i < packet.length / (int) sizeof(message.data); i++) {
+		extract(packet, message, i);
+		simulation->deliver_data(B, message);
+	}
+}
+
+// Keeps a copy of a good packet from the group B is waiting on, either
+// to deliver later or to rebuild another packet of the group from parity.
+void fec_store(const struct pkt& packet) {
+	int index = packet.seqnum - groupFirst;
+	if (fecGroupSize > 0 && index >= 0 && index < fecGroupSize) {
+		groupPackets[index] = packet;
+		groupHave[index] = true;
+	}
+}
+
+// Delivers the packets following expectedSequenceNum that are already
+// stored, then moves on to the next group once this one is complete.
+void deliver_stored() {
+	if (fecGroupSize == 0) {
+		return;
+	}
+	while (expectedSequenceNum < groupFirst + fecGroupSize && groupHave[expectedSequenceNum - groupFirst]) {
+		deliver_messages(groupPackets[expectedSequenceNum - groupFirst]);
+		if (expectedSequenceNum != groupRebuilt) {
+			fecBuffered++;
+		}
+		expectedSequenceNum++;
+	}
+	if (expectedSequenceNum >= groupFirst + fecGroupSize) {
+		groupFirst = ((expectedSequenceNum - 1) / fecGroupSize) * fecGroupSize + 1;
+		for (int i = 0; i < fecGroupSize; i++) {
+			groupHave[i] = false;
+		}
+	}
+}
+
+// Rebuilds the packet missing from the current group, if there is exactly one.
+bool fec_recover(const struct pkt& parity) {
+	if (parity.seqnum != groupFirst) {
+		return false;
+	}
+
+	int missing = -1;
+	for (int i = 0; i < fecGroupSize; i++) {
+		if (!groupHave[i]) {
+			if (missing != -1) {
+				return false;
+			}
+			missing = i;
+		}
+	}
+	if (missing == -1) {
+		return false;
+	}
+
+	struct pkt packet = make_pkt(groupFirst + missing, nullptr, 0, 0);
+	packet.length = -1 - parity.acknum;
+	memcpy(packet.payload, parity.payload, parity.length);
+	for (int i = 0; i < fecGroupSize; i++) {
+		if (i != missing) {
+			for (int j = 0; j < groupPackets[i].length; j++) {
+				packet.payload[j] ^= groupPackets[i].payload[j];
+			}
+			packet.length ^= groupPackets[i].length;
+		}
+	}
+	if (packet.length > MAX_PAYLOAD) {
+		return false;
+	}
+	packet.checksum = inputChecksum(packet);
+
+	INFO << "FEC_RECOVER: rebuilt packet " << packet.seqnum << " from the parity of group " << groupFirst << ENDL;
+	fecRecovered++;
+	groupRebuilt = packet.seqnum;
+	fec_store(packet);
+	return true;
+}
+
 // ***************************************************************************
 // // called from layer 3, when a packet arrives for layer 4 on side B 
 // ***************************************************************************
 void rdt_rcvB(struct pkt packet) {
 	INFO << "INFO: RTD_RCV_B: Layer 4 on side B has received a packet from layer 3 sent over the network from side A:" << " (seq = " << packet.seqnum << ". ack = " << packet.acknum << ", chk =" << packet.checksum << ") " << packet.payload << ENDL;
-	if (!is_corrupt(packet) && has_seqnum(packet, expectedSequenceNum)){
-		struct msg message;
-		extract(packet, message);
-		simulation->deliver_data(B, message);
-    
-		struct pkt ackPacket = make_pkt(0, "ACK", packet.seqnum, 0);
-		simulation->udt_send(B, ackPacket);
 
+	// Parity packets are not acknowledged, unless they fill the gap B is waiting on.
+	if (fecGroupSize > 0 && packet.acknum < 0) {
+		if (!is_corrupt(packet) && fec_recover(packet)) {
+			deliver_stored();
+			struct pkt ackPacket = make_ack(expectedSequenceNum - 1);
+			simulation->udt_send(B, ackPacket);
+		}
+		return;
+	}
+
+	if (!is_corrupt(packet) && has_seqnum(packet, expectedSequenceNum)){
+		deliver_messages(packet);
+		fec_store(packet);
 		expectedSequenceNum++;
+		deliver_stored();
+
+		struct pkt ackPacket = make_ack(expectedSequenceNum - 1);
+		simulation->udt_send(B, ackPacket);
     } else {
-	    struct pkt ackPacket = make_pkt(0, "ACK", expectedSequenceNum - 1, 0);
+	    if (!is_corrupt(packet)) {
+		    fec_store(packet);
+	    }
+	    struct pkt ackPacket = make_ack(expectedSequenceNum - 1);
 	    simulation->udt_send(B, ackPacket);
     }
 
@@ -218,18 +565,14 @@ void rdt_rcvB(struct pkt packet) {
 void A_timeout() {
     INFO << "A_TIMEOUT: Side A's timer has gone off." << ENDL;
 
-    int current = base;
-
-    while (current < nextSequenceNum) {
-	    int index = current % MAX_WINDOW_SIZE;
-	    if (sentPackets[index].seqnum != -1) {
-		simulation->udt_send(A, sentPackets[index]);
-		packetStartTimes[index] = simulation->getSimulatorClock();
-	    }
-	    current++;	    
+    if (congestion != nullptr) {
+	    congestion->on_timeout(simulation->getSimulatorClock());
     }
+    lastTimeout = simulation->getSimulatorTicks();
+    resendNext = base;
+    resend_window();
     if (base != nextSequenceNum) {
-	    simulation->start_timer(A, EstimatedRTT);
+	    simulation->start_timer_ticks(A, timeoutInterval());
     }
 }
 
@@ -240,5 +583,38 @@ void B_timeout() {
     INFO << "B_TIMEOUT: Side B's timer has gone off." << ENDL;
 }
 
+// ***************************************************************************
+// * Called when A's aggregation flush timer goes off
+// ***************************************************************************
+void A_flush() {
+    INFO << "A_FLUSH: Side A's flush timer has gone off." << ENDL;
+
+    flushTimerRunning = false;
+    flushDue = true;
+    flush_pending();
+}
+
+// ***************************************************************************
+// * Called when B's aggregation flush timer goes off
+// ***************************************************************************
+void B_flush() {
+    INFO << "B_FLUSH: Side B's flush timer has gone off." << ENDL;
+}
+
+// ***************************************************************************
+// * Called by the simulator at the end of a run to add protocol statistics
+// ***************************************************************************
+void rdt_report(std::ostream& os) {
+    if (congestion != nullptr) {
+        congestion->report(os, simulation->getSimulatorClock());
+    }
+    if (fecGroupSize > 0) {
+        os << "FEC: group size " << fecGroupSize << ", " << fecParitySent << " parity packets for "
+           << fecDataSent << " data packets (" << (fecDataSent ? 100.0 * fecParitySent / fecDataSent : 0.0)
+           << "% overhead), " << fecRecovered << " packets rebuilt from parity, "
+           << fecBuffered << " delivered from the out-of-order buffer" << std::endl;
+    }
+}
+
 //Note: I received assistance for the above functions from ChatGPT created by Open AI for code-related questions for this project.
 //Reference: https://openai.com/chatgpt
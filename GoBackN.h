@@ -9,7 +9,7 @@
 
 //extern simulator sim;
 
-struct pkt make_pkt(int sequenceNumber, const char data[20] = "", int ackNumber = 0, int checksum = 0);
+struct pkt make_pkt(int sequenceNumber, const char data[20] = nullptr, int ackNumber = 0, int checksum = 0);
 int computeChecksum(struct pkt packet);
 
 //added functions
@@ -17,10 +17,24 @@ bool is_corrupt(struct pkt packet);
 bool has_seqnum(struct pkt packet, int seqnum);
 int get_acknum(struct pkt packet);
 bool if_corrupt(struct pkt packet);
-void extract(const struct pkt& packet, struct msg& message);
+void extract(const struct pkt& packet, struct msg& message, int index = 0);
+struct pkt make_segment(int sequenceNumber, const char *data, int length);
+struct pkt make_ack(int ackNumber);
 void refuse_data(const char data[20]);
 
+// Upper limit on the retransmission timeout, in time units.
+extern float maxTimerValue;
 
+// Message aggregation settings, see rdt_sendA.
+extern int aggregateLimit;
+extern float aggregateDelay;
 
+// Forward error correction settings.  A parity group is rebuilt from the
+// packets still in the sender's window, so it can't be larger than that.
+#define MAX_FEC_GROUP 10
+extern int fecGroupSize;
 
-
+// Congestion control, nullptr to always use the fixed window.  The
+// sender keeps room for MAX_WINDOW_SIZE packets, the largest window.
+#define MAX_WINDOW_SIZE 64
+extern congestion_control *congestion;
@@ -0,0 +1,36 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Running batch means statistics used by the simulator's convergence mode.
+// ******************************************************************************************
+
+/* Two-sided 95% Student t quantiles, t(0.975, df) for df = 1..30. */
+static const double T975[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static double t975(long df) {
+    if (df <= 30)
+        return T975[df - 1];
+
+    /* Cornish-Fisher expansion around the normal quantile */
+    const double z = 1.959964;
+    return z + (z * z * z + z) / (4.0 * df)
+        + (5 * pow(z, 5) + 16 * pow(z, 3) + 3 * z) / (96.0 * df * df);
+}
+
+void batch_means::add(double batchValue) {
+    n++;
+    double delta = batchValue - mean;
+    mean += delta / n;
+    m2 += delta * (batchValue - mean);
+}
+
+double batch_means::halfwidth() const {
+    if (n < 2)
+        return std::numeric_limits<double>::infinity();
+    double variance = m2 / (n - 1);
+    return t975(n - 1) * sqrt(variance / n);
+}
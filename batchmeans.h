@@ -0,0 +1,29 @@
+// ***********************************************************
+// * Batch means confidence intervals.
+// *
+// * The output of one long run is cut into batches, and the batch
+// * averages are treated as roughly independent samples.  Their
+// * running mean and variance (Welford's method) give a Student t
+// * confidence interval for the steady state value.
+// ***********************************************************
+
+/* fewer batches than this never count as converged */
+#define MIN_BATCHES 10
+
+class batch_means {
+private:
+    long n;                   /* number of batches */
+    double mean;              /* running mean of the batch values */
+    double m2;                /* running sum of squared differences from the mean */
+
+public:
+    batch_means() : n(0), mean(0), m2(0) {}
+
+    void add(double batchValue);
+    long batches() const { return n; }
+    double estimate() const { return mean; }
+
+    // Half-width of the 95% confidence interval, infinite until there
+    // are at least two batches.
+    double halfwidth() const;
+};
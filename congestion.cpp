@@ -0,0 +1,115 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Congestion window controllers used by the Go-Back-N sender.
+// ******************************************************************************************
+
+/* Vegas thresholds, in packets queued along the path */
+#define DELAY_ALPHA 1.0
+#define DELAY_BETA  3.0
+
+congestion_control::congestion_control(int max) {
+    maxWindow = max;
+    cwnd = 1;
+    ssthresh = max;
+    decreases = 0;
+    area = 0;
+    lastChange = 0;
+    lastWindow = window();
+}
+
+
+void congestion_control::changed(double now, const char *event) {
+    cwnd = std::min(std::max(cwnd, 1.0), (double) maxWindow);
+
+    /* the trace only shows changes to the window actually in use */
+    int w = window();
+    if ((w == lastWindow) && (strcmp(event, "ack") == 0))
+        return;
+
+    area += lastWindow * (now - lastChange);
+    lastChange = now;
+    lastWindow = w;
+    if (trace.is_open())
+        trace << now << " " << cwnd << " " << ssthresh << " " << w << " " << event << "\n";
+}
+
+
+void congestion_control::on_timeout(double now) {
+    ssthresh = std::max(cwnd / 2, 2.0);
+    cwnd = 1;
+    decreases++;
+    changed(now, "timeout");
+}
+
+
+void congestion_control::set_trace(const std::string &filename) {
+    trace.open(filename);
+    if (!trace) {
+        FATAL << "Unable to open congestion window trace " << filename << "." << ENDL;
+        exit(-1);
+    }
+    trace << "# time cwnd ssthresh window event\n";
+    trace << 0 << " " << cwnd << " " << ssthresh << " " << window() << " start\n";
+}
+
+
+void congestion_control::report(std::ostream &os, double now) {
+    double total = area + lastWindow * (now - lastChange);
+    os << "Congestion control: " << name() << ", max window " << maxWindow
+        << ", final cwnd " << cwnd << ", ssthresh " << ssthresh
+        << ", average window " << (now > 0 ? total / now : (double) lastWindow)
+        << ", " << decreases << " decreases" << std::endl;
+}
+
+
+void reno_control::on_ack(double now, int acked, double /* rtt */) {
+    if (cwnd < ssthresh)
+        cwnd += acked;
+    else
+        cwnd += (double) acked / cwnd;
+    changed(now, "ack");
+}
+
+
+void delay_control::on_ack(double now, int acked, double rtt) {
+    if (rtt <= 0)
+        return;
+    if ((baseRTT == 0) || (rtt < baseRTT))
+        baseRTT = rtt;
+
+    /* expected minus actual rate, times the base round trip */
+    double queued = cwnd * (1 - baseRTT / rtt);
+
+    if ((cwnd < ssthresh) && (queued < DELAY_ALPHA)) {
+        cwnd += acked;
+    } else {
+        /* queues are building up, slow start is over */
+        ssthresh = std::min(ssthresh, cwnd);
+        if (queued < DELAY_ALPHA)
+            cwnd += (double) acked / cwnd;
+        else if (queued > DELAY_BETA)
+            cwnd -= (double) acked / cwnd;
+    }
+    changed(now, "ack");
+}
+
+
+congestion_control *make_congestion_control(const std::string &spec, int limit) {
+    std::string kind = spec.substr(0, spec.find(':'));
+    std::string args = (spec.find(':') == std::string::npos) ? "" : spec.substr(spec.find(':') + 1);
+
+    int max = 10;
+    if (!args.empty()) {
+        char *end;
+        max = std::strtol(args.c_str(), &end, 10);
+        if ((*end != '\0') || (max < 1) || (max > limit))
+            return nullptr;
+    }
+
+    if (kind == "reno")
+        return new reno_control(max);
+    if (kind == "delay")
+        return new delay_control(max);
+    return nullptr;
+}
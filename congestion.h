@@ -0,0 +1,67 @@
+// ***********************************************************
+// * Congestion control for the Go-Back-N sender.
+// *
+// * A controller keeps a congestion window, in packets, which the
+// * sender uses in place of its fixed window.  It is told about
+// * every ACK that moves the window forward and every timeout.
+// * Times and round trips are in simulated time units.
+// ***********************************************************
+
+class congestion_control {
+protected:
+    double cwnd;              /* congestion window, in packets */
+    double ssthresh;          /* slow start threshold, in packets */
+    int maxWindow;            /* the window never grows past this */
+    long decreases;           /* times the window was cut */
+    double area;              /* window integrated over time, for the average */
+    double lastChange;        /* time the window last changed */
+    int lastWindow;           /* window in use since then */
+    std::ofstream trace;      /* time, cwnd, ssthresh and window after each change */
+
+    // Called after cwnd or ssthresh changed, to keep the statistics and trace.
+    void changed(double now, const char *event);
+
+public:
+    explicit congestion_control(int max);
+    virtual ~congestion_control() = default;
+
+    // Packets the sender may have in flight.
+    int window() const { return std::min(std::max((int) cwnd, 1), maxWindow); }
+
+    // acked packets were newly acknowledged, rtt is the latest round trip sample.
+    virtual void on_ack(double now, int acked, double rtt) = 0;
+
+    // Multiplicative decrease: halve the threshold and start over from one packet.
+    virtual void on_timeout(double now);
+
+    virtual const char *name() const = 0;
+
+    void set_trace(const std::string &filename);
+    void report(std::ostream &os, double now);
+};
+
+/* Slow start up to ssthresh, then one packet more per round trip. */
+class reno_control : public congestion_control {
+public:
+    explicit reno_control(int max) : congestion_control(max) {}
+    void on_ack(double now, int acked, double rtt) override;
+    const char *name() const override { return "reno"; }
+};
+
+/* Vegas style: compares the round trip with the smallest one seen to  */
+/* estimate how many packets are queued, and keeps that between alpha */
+/* and beta instead of growing until something is lost.                */
+class delay_control : public congestion_control {
+private:
+    double baseRTT;           /* smallest round trip seen, 0 before the first */
+public:
+    explicit delay_control(int max) : congestion_control(max), baseRTT(0) {}
+    void on_ack(double now, int acked, double rtt) override;
+    const char *name() const override { return "delay"; }
+};
+
+// Builds a controller from a command line description:
+//   reno[:<max window>] | delay[:<max window>]
+// The max window defaults to 10 and can't be more than limit.
+// Returns nullptr if the description can't be understood.
+congestion_control *make_congestion_control(const std::string &spec, int limit);
@@ -0,0 +1,105 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Input mapping, output writing and end-of-run check for file transfer mode.
+// ******************************************************************************************
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+static uint64_t fnv1a(uint64_t h, const char *bytes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) bytes[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+
+file_transfer::file_transfer(const std::string &input, int segmentSize, const std::string &outputFile) {
+    if ((segmentSize < 1) || (segmentSize > MAX_SEGMENT)) {
+        FATAL << "Invalid segment size (" << segmentSize << "), must be 1 to " << MAX_SEGMENT << " bytes." << ENDL;
+        exit(-1);
+    }
+    mss = segmentSize;
+
+    int fd = open(input.c_str(), O_RDONLY);
+    struct stat st;
+    if ((fd < 0) || (fstat(fd, &st) < 0)) {
+        FATAL << "Unable to open input file " << input << ": " << strerror(errno) << ENDL;
+        exit(-1);
+    }
+    size = st.st_size;
+    if (size == 0) {
+        FATAL << "Input file " << input << " is empty." << ENDL;
+        exit(-1);
+    }
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        FATAL << "Unable to map input file " << input << ": " << strerror(errno) << ENDL;
+        exit(-1);
+    }
+    data = (const char *) map;
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    output = nullptr;
+    if (!outputFile.empty()) {
+        output = fopen(outputFile.c_str(), "wb");
+        if (output == nullptr) {
+            FATAL << "Unable to open output file " << outputFile << ": " << strerror(errno) << ENDL;
+            exit(-1);
+        }
+        setvbuf(output, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
+    }
+    hash = FNV_OFFSET_BASIS;
+    received = 0;
+
+    INFO << "Sending " << input << ", " << size << " bytes in " << segments()
+        << " segments of " << mss << " bytes" << ENDL;
+}
+
+
+file_transfer::~file_transfer() {
+    if (output != nullptr)
+        fclose(output);
+    munmap((void *) data, size);
+}
+
+
+const char *file_transfer::segment(long n, int &length) const {
+    size_t offset = (size_t) n * mss;
+    length = std::min((size_t) mss, size - offset);
+    return data + offset;
+}
+
+
+void file_transfer::receive(const char *bytes, int length) {
+    if ((output != nullptr) && (fwrite(bytes, 1, length, output) != (size_t) length)) {
+        FATAL << "Unable to write output file: " << strerror(errno) << ENDL;
+        exit(-1);
+    }
+    hash = fnv1a(hash, bytes, length);
+    received += length;
+}
+
+
+void file_transfer::report(std::ostream &os, double elapsed, double cpuSeconds) {
+    if (output != nullptr)
+        fflush(output);
+
+    uint64_t expected = fnv1a(FNV_OFFSET_BASIS, data, size);
+    os << "File transfer: received " << received << " of " << size << " bytes";
+    if (received < size)
+        os << ", incomplete";
+    else if (hash == expected)
+        os << ", output matches input";
+    else
+        os << ", OUTPUT DIFFERS FROM INPUT";
+    os << " (hash " << std::hex << hash << ", expected " << expected << std::dec << ")" << std::endl;
+
+    /* one time unit is taken as a millisecond, like in packet captures */
+    os << "Throughput: " << (elapsed > 0 ? received / (elapsed * 1000.0) : 0.0) << " MB per simulated second, "
+        << (received > 0 ? cpuSeconds * 1e9 / received : 0.0) << " CPU ns per byte" << std::endl;
+}
@@ -0,0 +1,35 @@
+// ***********************************************************
+// * Zero-copy file transfer from A to B.
+// *
+// * The input file is mapped read only and cut into segments of
+// * mss bytes.  Packets point straight into the mapping, so the
+// * bytes are only read to checksum them and, at B, to write them
+// * to the output file.  Everything B receives is hashed (64 bit
+// * FNV-1a) and compared with the input at the end of the run.
+// ***********************************************************
+
+class file_transfer {
+private:
+    const char *data;         /* the mapped input file */
+    size_t size;
+    int mss;                  /* bytes per segment, the last one may be shorter */
+    FILE *output;             /* nullptr if what B receives is only hashed */
+    uint64_t hash;            /* hash of the bytes B received so far */
+    size_t received;
+
+public:
+    file_transfer(const std::string &input, int segmentSize, const std::string &outputFile);
+    ~file_transfer();
+
+    long segments() const { return (size + mss - 1) / mss; }
+
+    // Segment n of the file, its length is returned in length.
+    const char *segment(long n, int &length) const;
+
+    // Bytes handed to the application at B, in order.
+    void receive(const char *bytes, int length);
+
+    // Check the output against the input and print the throughput for a
+    // run that took elapsed time units and cpuSeconds of processor time.
+    void report(std::ostream &os, double elapsed, double cpuSeconds);
+};
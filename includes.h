@@ -7,6 +7,18 @@
 #include <cstring>
 #include <algorithm>
 #include <math.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctime>
 
 
 inline int LOG_LEVEL = 3;
@@ -21,6 +33,13 @@ inline int LOG_LEVEL = 3;
 
 
 
+#include "batchmeans.h"
 #include "simulator.h"
+#include "traffic.h"
+#include "lossmodel.h"
+#include "topology.h"
+#include "pcap.h"
+#include "filetransfer.h"
 #include "main.h"
+#include "congestion.h"
 #include "GoBackN.h"
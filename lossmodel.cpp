@@ -0,0 +1,111 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Channel loss models used by the simulator to decide what happens to each packet.
+// ******************************************************************************************
+
+static bool probability(double x) {
+    return (x >= 0) && (x <= 1);
+}
+
+gilbert_elliott_loss::gilbert_elliott_loss(double p, double r, double lossGood, double lossBad, double c) {
+    this->p = p;
+    this->r = r;
+    this->lossGood = lossGood;
+    this->lossBad = lossBad;
+    corruptprob = c;
+    bad = false;
+}
+
+bool gilbert_elliott_loss::lose() {
+    bad = bad ? (simulator::jimsrand() >= r) : (simulator::jimsrand() < p);
+    return simulator::jimsrand() < (bad ? lossBad : lossGood);
+}
+
+correlated_corruption::correlated_corruption(double rate, double c, double l) {
+    lossprob = l;
+    correlation = c;
+    /* stationary rate = afterGood / (1 - correlation + afterGood) */
+    afterGood = rate * (1 - correlation) / (1 - rate);
+    last = false;
+}
+
+bool correlated_corruption::corrupt() {
+    last = simulator::jimsrand() < (last ? correlation : afterGood);
+    return last;
+}
+
+trace_loss::trace_loss(const std::string &filename) {
+    next = 0;
+
+    std::ifstream in(filename);
+    if (!in) {
+        FATAL << "Unable to open loss trace " << filename << "." << ENDL;
+        exit(-1);
+    }
+
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        lineno++;
+        for (char c : line) {
+            if (c == '#')
+                break;
+            if (c == '.' || c == '0')
+                fates.push_back('.');
+            else if (c == 'x' || c == '1')
+                fates.push_back('x');
+            else if (c == 'c')
+                fates.push_back('c');
+            else if (!isspace((unsigned char) c)) {
+                FATAL << filename << ":" << lineno << ": unknown packet fate '" << c << "'." << ENDL;
+                exit(-1);
+            }
+        }
+    }
+    if (fates.empty()) {
+        FATAL << "Loss trace " << filename << " has no packets." << ENDL;
+        exit(-1);
+    }
+}
+
+bool trace_loss::lose() {
+    char fate = fates[next];
+    next = (next + 1) % fates.size();
+    return fate == 'x';
+}
+
+loss_model *make_loss_model(const std::string &spec, double lossprob, double corruptprob) {
+    std::string kind = spec.substr(0, spec.find(':'));
+    std::string args = (spec.find(':') == std::string::npos) ? "" : spec.substr(spec.find(':') + 1);
+
+    if (kind == "trace")
+        return args.empty() ? nullptr : new trace_loss(args);
+
+    /* the rest take a list of numbers */
+    std::vector<double> values;
+    const char *s = args.c_str();
+    while (*s != '\0') {
+        char *end;
+        values.push_back(std::strtod(s, &end));
+        if ((end == s) || ((*end != ':') && (*end != '\0')))
+            return nullptr;
+        s = (*end == ':') ? end + 1 : end;
+    }
+    for (double v : values)
+        if (!probability(v))
+            return nullptr;
+
+    if ((kind == "iid") && (values.empty() || values.size() == 2))
+        return values.empty() ? new iid_loss(lossprob, corruptprob) : new iid_loss(values[0], values[1]);
+    if ((kind == "ge") && (values.size() == 2 || values.size() == 4) && (values[1] > 0)) {
+        double lossGood = (values.size() == 4) ? values[2] : 0.0;
+        double lossBad = (values.size() == 4) ? values[3] : 1.0;
+        return new gilbert_elliott_loss(values[0], values[1], lossGood, lossBad, corruptprob);
+    }
+    /* a rate above 1/2 needs enough correlation to keep runs going */
+    if ((kind == "corr") && (values.size() == 2) && (values[0] < 1) && (values[1] < 1)
+        && (values[0] * (1 - values[1]) <= 1 - values[0]))
+        return new correlated_corruption(values[0], values[1], lossprob);
+    return nullptr;
+}
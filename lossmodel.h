@@ -0,0 +1,84 @@
+// ***********************************************************
+// * Channel loss models.
+// *
+// * A loss model decides the fate of each packet a side hands to
+// * layer 3: whether it is lost and, if not, whether it arrives
+// * corrupted.  Each direction has its own model, so the data and
+// * ACK paths can behave differently.  lose() is asked once for
+// * every packet, corrupt() only for those that were not lost.
+// ***********************************************************
+
+class loss_model {
+public:
+    virtual ~loss_model() = default;
+    virtual bool lose() = 0;
+    virtual bool corrupt() = 0;
+    virtual const char *name() const = 0;
+};
+
+/* Independent draws for every packet, the original model. */
+class iid_loss : public loss_model {
+private:
+    double lossprob;
+    double corruptprob;
+public:
+    iid_loss(double l, double c) : lossprob(l), corruptprob(c) {}
+    bool lose() override { return simulator::jimsrand() < lossprob; }
+    bool corrupt() override { return simulator::jimsrand() < corruptprob; }
+    const char *name() const override { return "iid"; }
+};
+
+/* Gilbert-Elliott: the channel moves between a good and a bad state */
+/* before every packet, and each state has its own loss probability. */
+/* Corruption stays independent.                                     */
+class gilbert_elliott_loss : public loss_model {
+private:
+    double p;                 /* probability of going from good to bad */
+    double r;                 /* probability of going from bad to good */
+    double lossGood;
+    double lossBad;
+    double corruptprob;
+    bool bad;
+public:
+    gilbert_elliott_loss(double p, double r, double lossGood, double lossBad, double c);
+    bool lose() override;
+    bool corrupt() override { return simulator::jimsrand() < corruptprob; }
+    const char *name() const override { return "gilbert-elliott"; }
+};
+
+/* Corruption that comes in runs: after a corrupted packet the next   */
+/* one is corrupted with probability correlation, otherwise at a rate */
+/* chosen so that the long run average is rate.  Loss is independent. */
+class correlated_corruption : public loss_model {
+private:
+    double lossprob;
+    double correlation;
+    double afterGood;         /* probability of corruption after a good packet */
+    bool last;                /* the last packet was corrupted */
+public:
+    correlated_corruption(double rate, double correlation, double l);
+    bool lose() override { return simulator::jimsrand() < lossprob; }
+    bool corrupt() override;
+    const char *name() const override { return "correlated"; }
+};
+
+/* Packet fates replayed from a file, repeated when it runs out.  Each */
+/* character is one packet: '.' or '0' delivered, 'x' or '1' lost, 'c' */
+/* corrupted.  Whitespace is ignored and '#' starts a comment.          */
+class trace_loss : public loss_model {
+private:
+    std::string fates;
+    size_t next;
+public:
+    explicit trace_loss(const std::string &filename);
+    bool lose() override;
+    bool corrupt() override { return fates[(next + fates.size() - 1) % fates.size()] == 'c'; }
+    const char *name() const override { return "trace"; }
+};
+
+// Builds a model from a command line description:
+//   iid[:<loss>:<corrupt>] | ge:<p>:<r>[:<loss good>:<loss bad>] |
+//   corr:<rate>:<correlation> | trace:<file>
+// Values not given come from the -l and -c probabilities.
+// Returns nullptr if the description can't be understood.
+loss_model *make_loss_model(const std::string &spec, double lossprob, double corruptprob);
@@ -16,10 +16,22 @@ int main(int argc, char **argv) {
   double lossprob = -1.0;
   double corruptprob = - 1.0;
   double lambda = -1.0;
+  std::string traffic = "uniform";
+  std::string topologyFile;
+  std::string captureFile;
+  bool converge = false;
+  double precision = 0;
+  long warmup = 1000;
+  long batchSize = 1000;
+  std::string inputFile;
+  std::string outputFile;
+  int mss = 1460;
+  std::string cwndTrace;
+  std::string lossModels[2];
   
   int opt;
 
-  while ((opt = getopt(argc,argv,"n:l:c:t:d:")) != -1) {
+  while ((opt = getopt(argc,argv,"n:l:c:t:d:g:T:w:a:f:r:C:F:k:K:m:M:x:")) != -1) {
     
     switch (opt) {
     case 'n':
@@ -37,6 +49,87 @@ int main(int argc, char **argv) {
     case 'd':
       LOG_LEVEL = std::strtol(optarg,nullptr, 10);
       break;
+    case 'g':
+      traffic = optarg;
+      break;
+    case 'T':
+      topologyFile = optarg;
+      break;
+    case 'w':
+      captureFile = optarg;
+      break;
+    case 'a': {
+      char *end;
+      aggregateLimit = std::strtol(optarg, &end, 10);
+      if (*end == ':')
+        aggregateDelay = std::strtod(end + 1, nullptr);
+      if ((aggregateLimit < 1) || (aggregateLimit > MAX_PAYLOAD / (int) sizeof(msg::data)) || (aggregateDelay < 0)) {
+        FATAL << "Invalid aggregation (" << optarg << "), at most "
+          << MAX_PAYLOAD / sizeof(msg::data) << " msgs per packet." << ENDL;
+        exit(-1);
+      }
+      break;
+    }
+    case 'C': {
+      char *end;
+      converge = true;
+      precision = std::strtod(optarg, &end);
+      if (*end == ':')
+        warmup = std::strtol(end + 1, &end, 10);
+      if (*end == ':')
+        batchSize = std::strtol(end + 1, &end, 10);
+      break;
+    }
+    case 'F': {
+      std::string spec = optarg;
+      size_t colon = spec.find(':');
+      inputFile = spec.substr(0, colon);
+      if (colon != std::string::npos) {
+        char *end;
+        mss = std::strtol(spec.c_str() + colon + 1, &end, 10);
+        if (*end == ':')
+          outputFile = end + 1;
+      }
+      break;
+    }
+    case 'k':
+      delete congestion;
+      congestion = make_congestion_control(optarg, MAX_WINDOW_SIZE);
+      if (congestion == nullptr) {
+        FATAL << "Invalid congestion control (" << optarg << "), max window is 1 to " << MAX_WINDOW_SIZE << "." << ENDL;
+        exit(-1);
+      }
+      break;
+    case 'K':
+      cwndTrace = optarg;
+      break;
+    case 'm':
+      lossModels[A] = optarg;
+      break;
+    case 'M':
+      lossModels[B] = optarg;
+      break;
+    case 'x':
+      maxTimerValue = std::strtod(optarg, nullptr);
+      if (maxTimerValue <= 0) {
+        FATAL << "Invalid maximum timeout (" << optarg << "), must be positive." << ENDL;
+        exit(-1);
+      }
+      break;
+    case 'r':
+      simulator::resolution = std::strtoll(optarg, nullptr, 10);
+      if (simulator::resolution <= 0) {
+        FATAL << "Invalid clock resolution (" << optarg << "), must be at least 1 tick per time unit." << ENDL;
+        exit(-1);
+      }
+      break;
+    case 'f':
+      fecGroupSize = std::strtol(optarg, nullptr, 10);
+      if ((fecGroupSize < 0) || (fecGroupSize > MAX_FEC_GROUP)) {
+        FATAL << "Invalid FEC group size (" << optarg << "), must be 0 to " << MAX_FEC_GROUP << "." << ENDL;
+        exit(-1);
+      }
+      break;
     case ':':
     case '?':
     default:
@@ -45,7 +138,24 @@ int main(int argc, char **argv) {
         << "-l <prob of loss> "
         << "-c <prob of corruption> "
         << "-t <avg time between messages> "
-        << "-d <debug level>" << std::endl;
+        << "-d <debug level> "
+        << "[-g <traffic model>] "
+        << "[-T <topology file>] "
+        << "[-w <pcap-ng file>] "
+        << "[-a <msgs per packet>[:<flush delay>]] "
+        << "[-f <FEC group size>] "
+        << "[-r <clock ticks per time unit>] "
+        << "[-x <max timeout>] "
+        << "[-C <precision>[:<warm-up msgs>[:<batch msgs>]]] "
+        << "[-F <input file>[:<mss>[:<output file>]]] "
+        << "[-k <congestion control>[:<max window>]] "
+        << "[-K <cwnd trace file>] "
+        << "[-m <loss model A to B>] "
+        << "[-M <loss model B to A>]" << std::endl;
+      std::cout << "\t-g uniform|poisson|onoff:<mean on>:<mean off>|bulk|trace:<file>" << std::endl;
+      std::cout << "\t-f also makes B keep out-of-order packets of the group it is waiting on and deliver them once the gap is filled" << std::endl;
+      std::cout << "\t-k reno|delay" << std::endl;
+      std::cout << "\t-m, -M iid[:<loss>:<corrupt>]|ge:<p>:<r>[:<loss good>:<loss bad>]|corr:<rate>:<correlation>|trace:<file>" << std::endl;
       std::cout << "\t-d 4 sets log level to info" << std::endl;
       std::cout << "\t-d 5 sets log level to debug" << std::endl;
       std::cout << "\t-d 6 sets log level to trace" << std::endl;
@@ -53,7 +163,40 @@ int main(int argc, char **argv) {
     }
   }
 
+  /* when sending a file, its size decides how many segments there are */
+  if (!inputFile.empty()) {
+    if ((aggregateLimit > 1) || (fecGroupSize > 0)) {
+      FATAL << "File transfer can't be combined with aggregation or FEC." << ENDL;
+      exit(-1);
+    }
+    if (nismmax != -1) {
+      FATAL << "File transfer sends the whole file, -n can't be given with -F." << ENDL;
+      exit(-1);
+    }
+    nismmax = 1;
+  }
+
+  if (!cwndTrace.empty()) {
+    if (congestion == nullptr) {
+      FATAL << "A cwnd trace needs congestion control (-k)." << ENDL;
+      exit(-1);
+    }
+    congestion->set_trace(cwndTrace);
+  }
+
   simulation = new simulator(nismmax,lossprob,corruptprob,lambda);
+  simulation->set_traffic(traffic);
+  for (int side = A; side <= B; side++)
+    if (!lossModels[side].empty())
+      simulation->set_loss_model(side, lossModels[side]);
+  if (!topologyFile.empty())
+    simulation->set_topology(topologyFile);
+  if (!captureFile.empty())
+    simulation->set_capture(captureFile);
+  if (converge)
+    simulation->set_convergence(precision, warmup, batchSize);
+  if (!inputFile.empty())
+    simulation->set_file_transfer(inputFile, mss, outputFile);
 
   A_init();
   B_init();
@@ -74,8 +217,12 @@ std::ostream& operator<<(std::ostream& os, const struct pkt& packet)
   os << "(seq = " << packet.seqnum;
   os << ", ack = " << packet.acknum;
   os << ", chk = " << packet.checksum << ") ";
-  for (auto c : packet.payload) {
-    os << c;
+  if (packet.data != nullptr) {
+    os << packet.length << " bytes";
+    return os;
+  }
+  for (int i = 0; i < packet.length && i < MAX_PAYLOAD; i++) {
+    os << packet.payload[i];
   }
   return os;
 }
@@ -7,6 +7,7 @@ void B_init();
 
 bool rdt_sendA(struct msg message);
 bool rdt_sendB(struct msg message);  /* You should leave this empy */
+bool rdt_send_segmentA(const char *data, int length);  /* file transfer mode */
 
 void rdt_rcvA(struct pkt packet);
 void rdt_rcvB(struct pkt packet);
@@ -14,6 +15,11 @@ void rdt_rcvB(struct pkt packet);
 void A_timeout();
 void B_timeout();
 
+void A_flush();
+void B_flush();
+
+void rdt_report(std::ostream& os);
+
 // ***********************************************************
 // ** Simple operator functions to make output look cleaner.
 // ***********************************************************
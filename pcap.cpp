@@ -0,0 +1,165 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Buffered pcap-ng writer for simulated traffic.
+// ******************************************************************************************
+
+#define PCAP_BUFFER_SIZE (4 * 1024 * 1024)
+#define PCAP_PKT_HEADER  12                      /* seqnum, acknum, checksum */
+#define LINKTYPE_RAW     101
+
+static const uint32_t SIDE_ADDRS[] = {0x0a000001, 0x0a000002};   /* 10.0.0.1, 10.0.0.2 */
+static const uint16_t SIDE_PORTS[] = {5000, 5001};
+
+
+pcap_writer::pcap_writer(const std::string &filename) {
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        FATAL << "Unable to open capture file " << filename << ": " << strerror(errno) << ENDL;
+        exit(-1);
+    }
+    buffer.resize(PCAP_BUFFER_SIZE);
+    used = 0;
+    records = 0;
+
+    /* Section Header Block */
+    append32(0x0A0D0D0A);
+    append32(28);
+    append32(0x1A2B3C4D);            /* byte order magic */
+    uint16_t version[2] = {1, 0};
+    append(version, sizeof(version));
+    int64_t sectionLength = -1;      /* not known up front */
+    append(&sectionLength, sizeof(sectionLength));
+    append32(28);
+
+    /* Interface Description Block, raw IPv4, default microsecond timestamps */
+    append32(0x00000001);
+    append32(20);
+    uint16_t linktype[2] = {LINKTYPE_RAW, 0};
+    append(linktype, sizeof(linktype));
+    append32(0);                     /* no snap length */
+    append32(20);
+
+    /* IPv4 and UDP headers for each direction, lengths and IP id left at zero */
+    for (int side = A; side <= B; side++) {
+        int other = (side + 1) % 2;
+        unsigned char *frame = headers[side];
+        memset(frame, 0, PCAP_HEADER_SIZE);
+        frame[0] = 0x45;
+        frame[8] = 64;               /* ttl */
+        frame[9] = IPPROTO_UDP;
+        *(uint32_t *) (frame + 12) = htonl(SIDE_ADDRS[side]);
+        *(uint32_t *) (frame + 16) = htonl(SIDE_ADDRS[other]);
+        *(uint16_t *) (frame + 20) = htons(SIDE_PORTS[side]);
+        *(uint16_t *) (frame + 22) = htons(SIDE_PORTS[other]);
+        /* no UDP checksum */
+
+        uint32_t sum = 0;
+        for (int i = 0; i < 20; i += 2)
+            sum += (frame[i] << 8) | frame[i + 1];
+        while (sum >> 16)
+            sum = (sum & 0xffff) + (sum >> 16);
+        headerSums[side] = sum;
+    }
+
+    INFO << "Capturing simulated traffic to " << filename << ENDL;
+}
+
+
+pcap_writer::~pcap_writer() {
+    flush();
+    close(fd);
+    INFO << "Captured " << records << " packets." << ENDL;
+}
+
+
+void pcap_writer::append(const void *data, size_t len) {
+    if (used + len > buffer.size())
+        flush();
+    memcpy(buffer.data() + used, data, len);
+    used += len;
+}
+
+
+void pcap_writer::flush() {
+    size_t done = 0;
+    while (done < used) {
+        ssize_t n = write(fd, buffer.data() + done, used - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            FATAL << "Unable to write capture file: " << strerror(errno) << ENDL;
+            exit(-1);
+        }
+        done += n;
+    }
+    used = 0;
+}
+
+
+void pcap_writer::record(double t, int AorB, const struct pkt &packet, uint32_t flags, const char *comment) {
+    size_t payloadLength = std::min(std::max(packet.length, 0), (packet.data != nullptr) ? MAX_SEGMENT : MAX_PAYLOAD);
+    size_t frameLength = PCAP_HEADER_SIZE + PCAP_PKT_HEADER + payloadLength;
+    size_t paddedFrameLength = frameLength + (4 - frameLength % 4) % 4;
+    size_t commentLength = (comment != nullptr) ? strlen(comment) : 0;
+    size_t optionsLength = 8 + 4;                    /* epb_flags + opt_endofopt */
+    if (commentLength > 0)
+        optionsLength += 4 + commentLength + (4 - commentLength % 4) % 4;
+    uint32_t blockLength = 28 + paddedFrameLength + optionsLength + 4;
+
+    /* the whole block is built in place, so make room for it first */
+    if (used + blockLength > buffer.size())
+        flush();
+    unsigned char *block = (unsigned char *) buffer.data() + used;
+    uint32_t *words = (uint32_t *) block;
+
+    /* simulated time units are milliseconds, timestamps are microseconds */
+    uint64_t ts = llround(t * 1000.0);
+
+    /* Enhanced Packet Block */
+    words[0] = 0x00000006;
+    words[1] = blockLength;
+    words[2] = 0;                    /* interface */
+    words[3] = ts >> 32;
+    words[4] = ts & 0xffffffff;
+    words[5] = frameLength;
+    words[6] = frameLength;
+    unsigned char *frame = block + 28;
+
+    /* IPv4 and UDP headers come from the template for this direction, */
+    /* only the lengths, the IP id and the header checksum change.      */
+    memcpy(frame, headers[AorB], PCAP_HEADER_SIZE);
+    uint16_t id = records & 0xffff;
+    uint32_t sum = headerSums[AorB] + id + frameLength;
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    *(uint16_t *) (frame + 2) = htons(frameLength);
+    *(uint16_t *) (frame + 4) = htons(id);
+    *(uint16_t *) (frame + 10) = htons(~sum & 0xffff);
+    *(uint16_t *) (frame + 24) = htons(frameLength - 20);
+
+    /* the packet itself */
+    *(uint32_t *) (frame + 28) = htonl(packet.seqnum);
+    *(uint32_t *) (frame + 32) = htonl(packet.acknum);
+    *(uint32_t *) (frame + 36) = htonl(packet.checksum);
+    memcpy(frame + 40, pkt_bytes(packet), payloadLength);
+    memset(frame + frameLength, 0, paddedFrameLength - frameLength);
+
+    unsigned char *option = frame + paddedFrameLength;
+    if (commentLength > 0) {
+        size_t padded = commentLength + (4 - commentLength % 4) % 4;
+        *(uint16_t *) option = 1;                                  /* opt_comment */
+        *(uint16_t *) (option + 2) = commentLength;
+        memset(option + 4 + commentLength, 0, padded - commentLength);
+        memcpy(option + 4, comment, commentLength);
+        option += 4 + padded;
+    }
+    *(uint16_t *) option = 2;                                      /* epb_flags */
+    *(uint16_t *) (option + 2) = 4;
+    *(uint32_t *) (option + 4) = flags;
+    *(uint32_t *) (option + 8) = 0;                                /* opt_endofopt */
+    words[blockLength / 4 - 1] = blockLength;
+
+    used += blockLength;
+    records++;
+}
@@ -0,0 +1,42 @@
+// ***********************************************************
+// * pcap-ng capture of simulated traffic.
+// *
+// * Every packet is wrapped in a synthetic IPv4/UDP header, side A
+// * is 10.0.0.1:5000 and side B is 10.0.0.2:5001.  The pkt fields
+// * follow in network byte order (seqnum, acknum, checksum) and then
+// * the length bytes of payload in use.
+// * One simulated time unit is recorded as one millisecond.
+// *
+// * Output is collected in a large buffer and written in big chunks,
+// * so there is one write() per 4 MiB rather than one per packet.
+// * A capture still costs the time to produce about 100 bytes per
+// * record, which on a bulk run is a large share of the run time.
+// ***********************************************************
+
+/* epb_flags direction bits */
+#define PCAP_INBOUND  1
+#define PCAP_OUTBOUND 2
+
+#define PCAP_HEADER_SIZE (20 + 8)        /* IPv4 + UDP */
+
+class pcap_writer {
+private:
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+    long records;
+    unsigned char headers[2][PCAP_HEADER_SIZE];   /* IPv4/UDP headers sent by side A and B */
+    uint32_t headerSums[2];                       /* their checksums before folding in the id */
+
+    void append(const void *data, size_t len);
+    void append32(uint32_t value) { append(&value, sizeof(value)); }
+
+public:
+    explicit pcap_writer(const std::string &filename);
+    ~pcap_writer();
+
+    // Record pkt as sent from side AorB to the other side at simulated time t.
+    // flags are PCAP_INBOUND/PCAP_OUTBOUND, comment may be nullptr.
+    void record(double t, int AorB, const struct pkt &packet, uint32_t flags, const char *comment);
+    void flush();
+};
@@ -30,6 +30,8 @@ the emulator, you're welcome to look at the code - but again, you should have
 to, and you defeinitely should not have to modify
 ******************************************************************/
 
+int64_t simulator::resolution = 1000000;
+
 simulator::simulator(long n, double l, double c, double t) {
 
 
@@ -47,15 +49,40 @@ simulator::simulator(long n, double l, double c, double t) {
     // ***************************************************************************
     evlist = nullptr;
     nsim = 0;
-    kr_time = 0.000;
+    kr_time = 0;
     ntolayer3 = 0;
+    packetsSent[A] = 0;
+    packetsSent[B] = 0;
     nlost = 0;
     ncorrupt = 0;
-    kr_time = 0.0;
+    for (int side = A; side <= B; side++) {
+        channels[side] = new iid_loss(lossprob, corruptprob);
+        lostBy[side] = 0;
+        corruptedBy[side] = 0;
+        lossBursts[side] = 0;
+        lastLost[side] = false;
+    }
+    kr_time = 0;
     messagesReceived[A] = 0;
     messagesReceived[B] = 0;    
+    bytesReceived[A] = 0;
+    bytesReceived[B] = 0;
+    traffic = new uniform_traffic(lambda);
+    sourceBlocked = false;
+    net = nullptr;
+    ntimeouts = 0;
+    capture = nullptr;
+    precision = 0;
+    warmup = 0;
+    batchSize = 0;
+    batchCount = 0;
+    batchStart = 0;
+    batchLatency = 0;
+    batchBytes = 0;
+    converged = false;
+    transfer = nullptr;
+    cpuSeconds = 0;
     srandom(time(nullptr));
-    generate_next_arrival();
 
 
     // ***************************************************************************
@@ -88,11 +115,66 @@ simulator::simulator(long n, double l, double c, double t) {
 }
 
 
+void simulator::set_traffic(const std::string &spec) {
+    traffic_model *model = make_traffic_model(spec, lambda);
+    if (model == nullptr) {
+        FATAL << "Invalid traffic model (" << spec << ")." << ENDL;
+        exit(-1);
+    }
+    delete traffic;
+    traffic = model;
+    INFO << "Application traffic model: " << traffic->name() << ENDL;
+}
+
+
+void simulator::set_loss_model(int AorB, const std::string &spec) {
+    loss_model *model = make_loss_model(spec, lossprob, corruptprob);
+    if (model == nullptr) {
+        FATAL << "Invalid loss model (" << spec << ")." << ENDL;
+        exit(-1);
+    }
+    delete channels[AorB];
+    channels[AorB] = model;
+    INFO << "Loss model from " << SIDE_NAMES[AorB] << " to " << SIDE_NAMES[(AorB + 1) % 2] << ": " << model->name() << ENDL;
+}
+
+
+void simulator::set_topology(const std::string &filename) {
+    net = new topology(filename);
+}
+
+
+void simulator::set_capture(const std::string &filename) {
+    capture = new pcap_writer(filename);
+}
+
+
+void simulator::set_convergence(double p, long w, long b) {
+    if ((p <= 0) || (w < 0) || (b <= 0)) {
+        FATAL << "Invalid convergence target (" << p << ", warm-up " << w << ", batch " << b << ")." << ENDL;
+        exit(-1);
+    }
+    precision = p;
+    warmup = w;
+    batchSize = b;
+    INFO << "Running until the 95% confidence intervals are within " << precision * 100
+        << "% of the estimates, warm-up " << warmup << " msgs, batches of " << batchSize << " msgs" << ENDL;
+}
+
+
+void simulator::set_file_transfer(const std::string &input, int mss, const std::string &output) {
+    transfer = new file_transfer(input, mss, output);
+    nsimmax = transfer->segments();
+}
+
+
 void simulator::go() {
     srand(time(nullptr));
+    std::clock_t cpuStart = std::clock();
+    generate_next_arrival();
 
     struct event *eventptr;
-    while (eventptr = evlist) {
+    while (!converged && (eventptr = evlist)) {
 
 
         //
@@ -112,21 +194,46 @@ void simulator::go() {
         //
         if ((eventptr->evtype == FROM_LAYER5) && (nsim != nsimmax)) {
 
-            // This adds the next FROM_LAYER5 event to the event list.
-            generate_next_arrival();
-
-            /* fill in msg to give with string of same letter */
-            struct msg msg2give { };
-            std::fill(msg2give.data, msg2give.data + sizeof(msg2give.data),(char)(97 + (nsim % 26)));
-            DEBUG << "MAINLOOP (" << kr_time << "): Triggering "
-                 << EVENT_NAMES[eventptr->evtype] << ", on side " << SIDE_NAMES[eventptr->eventity]
-                 << ", " << msg2give << ENDL;
-
-            // Pass the message down to the student.
-            if (eventptr->eventity == A) {
-                if (rdt_sendA(msg2give)) { nsim++; }
+            // This adds the next FROM_LAYER5 event to the event list.  A saturating
+            // source waits to see whether this message is accepted first.
+            if (!traffic->saturating())
+                generate_next_arrival();
+
+            bool accepted;
+            if (transfer != nullptr) {
+                /* the next segment of the file, only A sends one */
+                int length;
+                const char *segment = transfer->segment(nsim, length);
+                DEBUG << "MAINLOOP (" << getSimulatorClock() << "): Triggering "
+                     << EVENT_NAMES[eventptr->evtype] << ", on side " << SIDE_NAMES[eventptr->eventity]
+                     << ", segment " << nsim << " (" << length << " bytes)" << ENDL;
+                accepted = (eventptr->eventity == A) && rdt_send_segmentA(segment, length);
             } else {
-                if (rdt_sendB(msg2give)) { nsim++; }
+                /* fill in msg to give with string of same letter */
+                struct msg msg2give { };
+                std::fill(msg2give.data, msg2give.data + sizeof(msg2give.data),(char)(97 + (nsim % 26)));
+                DEBUG << "MAINLOOP (" << getSimulatorClock() << "): Triggering "
+                     << EVENT_NAMES[eventptr->evtype] << ", on side " << SIDE_NAMES[eventptr->eventity]
+                     << ", " << msg2give << ENDL;
+
+                // Pass the message down to the student.
+                if (eventptr->eventity == A) {
+                    accepted = rdt_sendA(msg2give);
+                } else {
+                    accepted = rdt_sendB(msg2give);
+                }
+            }
+            if (accepted) {
+                nsim++;
+                if (eventptr->eventity == A)
+                    latencies.push_back(kr_time);
+            }
+
+            if (traffic->saturating()) {
+                if (accepted)
+                    generate_next_arrival();
+                else
+                    sourceBlocked = true;
             }
         }
 
@@ -136,15 +243,19 @@ void simulator::go() {
                     .seqnum = eventptr->pktptr->seqnum,
                     .acknum = eventptr->pktptr->acknum,
                     .checksum = eventptr->pktptr->checksum,
+                    .length = eventptr->pktptr->length,
+                    .data = eventptr->pktptr->data,
                     .payload = {}
             };
 
-            for (int i = 0; i < 20; i++)
-                pkt2give.payload[i] = eventptr->pktptr->payload[i];
+            if (pkt2give.data == nullptr)
+                memcpy(pkt2give.payload, eventptr->pktptr->payload, pkt2give.length);
 
-            DEBUG << "MAINLOOP (" << kr_time << "): Triggering "
+            DEBUG << "MAINLOOP (" << getSimulatorClock() << "): Triggering "
                 << EVENT_NAMES[eventptr->evtype] << ", on side " << SIDE_NAMES[eventptr->eventity]
                 << ", " << pkt2give << ENDL;
+            if (capture != nullptr)
+                capture->record(getSimulatorClock(), (eventptr->eventity + 1) % 2, pkt2give, PCAP_INBOUND, nullptr);
             if (eventptr->eventity == A)      /* deliver packet by calling */
                 rdt_rcvA(pkt2give);            /* appropriate entity */
             else
@@ -152,26 +263,126 @@ void simulator::go() {
 
             free(eventptr->pktptr);          /* free the memory for packet */
 
+            if (net != nullptr)
+                net->links[net->routes[eventptr->eventity][eventptr->hop]].queued--;
+        }
+
+        if (eventptr->evtype == AT_ROUTER) {
+            DEBUG << "MAINLOOP (" << getSimulatorClock() << "): Triggering "
+                << EVENT_NAMES[eventptr->evtype] << " for side " << SIDE_NAMES[eventptr->eventity]
+                << ", " << *eventptr->pktptr << ENDL;
+
+            /* store and forward: the packet leaves this hop and queues for the next */
+            net->links[net->routes[eventptr->eventity][eventptr->hop]].queued--;
+            struct event *evptr = forward(eventptr->eventity, eventptr->hop + 1, eventptr->pktptr);
+            if (evptr != nullptr)
+                insertevent(evptr);
         }
 
         if (eventptr->evtype == TIMER_INTERRUPT) {
-            DEBUG << "MAINLOOP (" << kr_time << "): Triggering "
+            DEBUG << "MAINLOOP (" << getSimulatorClock() << "): Triggering "
                  << EVENT_NAMES[eventptr->evtype] << ", on side " << SIDE_NAMES[eventptr->eventity] << ENDL;
+            ntimeouts++;
             if (eventptr->eventity == A)
                 A_timeout();
             else
                 B_timeout();
         }
 
+        if (eventptr->evtype == FLUSH_INTERRUPT) {
+            DEBUG << "MAINLOOP (" << getSimulatorClock() << "): Triggering "
+                 << EVENT_NAMES[eventptr->evtype] << ", on side " << SIDE_NAMES[eventptr->eventity] << ENDL;
+            if (eventptr->eventity == A)
+                A_flush();
+            else
+                B_flush();
+        }
+
+        //
+        // Anything other than a new message may have opened the sender's window,
+        // so let a blocked saturating source try again.
+        //
+        if ((eventptr->evtype != FROM_LAYER5) && sourceBlocked && (nsim != nsimmax)) {
+            sourceBlocked = false;
+            generate_next_arrival();
+        }
+
         free(eventptr);
     }
+    cpuSeconds = (double) (std::clock() - cpuStart) / CLOCKS_PER_SEC;
 
-    INFO << "MAINLOOP (" << kr_time << "): Simulator terminated after sending " << nsim << " msgs from layer5." <<ENDL;
+    /* a converged run stops with packets still in flight */
+    while ((eventptr = evlist) != nullptr) {
+        evlist = evlist->next;
+        if (eventptr->evtype == FROM_LAYER3 || eventptr->evtype == AT_ROUTER)
+            free(eventptr->pktptr);
+        free(eventptr);
+    }
+
+    INFO << "MAINLOOP (" << getSimulatorClock() << "): Simulator terminated after sending " << nsim << " msgs from layer5." <<ENDL;
+
+    report();
+
+    delete capture;
+    capture = nullptr;
+    delete transfer;
+    transfer = nullptr;
 }
 
 
 
 
+void simulator::report() {
+    long delivered = messagesReceived[A] + messagesReceived[B];
+
+    double now = getSimulatorClock();
+
+    long long bytes = bytesReceived[A] + bytesReceived[B];
+
+    std::cout << "Delivered " << delivered << (transfer ? " segments" : " msgs") << " in " << now << " time units, goodput "
+        << (now > 0 ? bytes / now : 0.0) << " bytes per time unit" << std::endl;
+    /* A carries the data and B only acknowledges, so ACKs stay out of the ratio */
+    std::cout << "Packets sent: " << packetsSent[A] << " by A ("
+        << (messagesReceived[B] > 0 ? (double) packetsSent[A] / messagesReceived[B] : 0.0)
+        << (transfer ? " per segment" : " per msg") << " delivered to B), " << packetsSent[B] << " by B; "
+        << nlost << " lost, " << ncorrupt << " corrupted, " << ntimeouts << " timer interrupts" << std::endl;
+    for (int side = A; side <= B; side++) {
+        std::cout << "Channel " << SIDE_NAMES[side] << " -> " << SIDE_NAMES[(side + 1) % 2] << " (" << channels[side]->name() << "): "
+            << lostBy[side] << " of " << packetsSent[side] << " lost in " << lossBursts[side] << " bursts (mean length "
+            << (lossBursts[side] ? (double) lostBy[side] / lossBursts[side] : 0.0) << "), "
+            << corruptedBy[side] << " corrupted" << std::endl;
+    }
+
+    /* only the messages that made it have a delivery latency */
+    size_t ndelivered = std::min((size_t) messagesReceived[B], latencies.size());
+    if (ndelivered > 0) {
+        std::sort(latencies.begin(), latencies.begin() + ndelivered);
+        double total = 0;
+        for (size_t i = 0; i < ndelivered; i++)
+            total += units(latencies[i]);
+        std::cout << "Delivery latency: mean " << total / ndelivered
+            << ", p50 " << units(latencies[(ndelivered - 1) / 2])
+            << ", p99 " << units(latencies[(ndelivered - 1) * 99 / 100])
+            << ", max " << units(latencies[ndelivered - 1]) << std::endl;
+    }
+    if (precision > 0) {
+        std::cout << (converged ? "Converged" : "Did not converge") << " after " << goodput.batches()
+            << " batches of " << batchSize << " msgs (" << warmup << " msg warm-up), 95% confidence:" << std::endl;
+        std::cout << "  goodput " << goodput.estimate() << " +/- " << goodput.halfwidth() << " bytes per time unit" << std::endl;
+        std::cout << "  latency " << latency.estimate() << " +/- " << latency.halfwidth() << std::endl;
+    }
+    if (transfer != nullptr)
+        transfer->report(std::cout, now, cpuSeconds);
+    rdt_report(std::cout);
+
+    if (net != nullptr) {
+        std::cout << "Path: " << net->routes[B].size() << " hops from A to B, "
+            << net->routes[A].size() << " hops from B to A" << std::endl;
+        net->report(std::cout);
+    }
+}
+
+
 /****************************************************************************/
 /* jimsrand(): return a float in range [0,1].  The routine below is used to */
 /* isolate all random number generation in one location.  We assume that the*/
@@ -186,13 +397,18 @@ double simulator::jimsrand() {
 /*****************************************************/
 void simulator::generate_next_arrival() {
 
-    auto *evptr = new  event();
+    double when = traffic->next_arrival(getSimulatorClock());
+    if (when < 0) {
+        DEBUG << "GENERATE NEXT ARRIVAL (" << getSimulatorClock()
+            << "): " << traffic->name() << " source has no more messages to offer" << ENDL;
+        return;
+    }
 
-    /* Delay will be uniform on [0,2*lambda] */
-    evptr->evtime = kr_time + ( lambda * jimsrand() * 2);
+    auto *evptr = new  event();
+    evptr->evtime = std::max(kr_time, ticks(when));
 
-    DEBUG << "GENERATE NEXT ARRIVAL (" << kr_time
-        << "): scheduling next message from application to be given to layer 4 at " << evptr->evtime << ENDL;
+    DEBUG << "GENERATE NEXT ARRIVAL (" << getSimulatorClock()
+        << "): scheduling next message from application to be given to layer 4 at " << units(evptr->evtime) << ENDL;
 
     evptr->evtype = FROM_LAYER5;
     if (BIDIRECTIONAL && (jimsrand() > 0.5))
@@ -206,8 +422,8 @@ void simulator::generate_next_arrival() {
 void simulator::insertevent(struct event *p) {
     struct event *q, *qold;
 
-    TRACE << "INSERTEVENT (" << kr_time << "): Inserting " << EVENT_NAMES[p->evtype]
-        << " type event to happen at " << p->evtime << ENDL;
+    TRACE << "INSERTEVENT (" << getSimulatorClock() << "): Inserting " << EVENT_NAMES[p->evtype]
+        << " type event to happen at " << units(p->evtime) << ENDL;
 
     q = evlist;     /* q points to header of list in which p struct inserted */
     if (q == nullptr) {   /* list is empty */
@@ -215,7 +431,8 @@ void simulator::insertevent(struct event *p) {
         p->next = nullptr;
         p->prev = nullptr;
     } else {
-        for (qold = q; q != nullptr && p->evtime > q->evtime; q = q->next)
+        /* events due at the same time run in the order they were inserted */
+        for (qold = q; q != nullptr && p->evtime >= q->evtime; q = q->next)
             qold = q;
         if (q == nullptr) {   /* end of list */
             qold->next = p;
@@ -235,11 +452,39 @@ void simulator::insertevent(struct event *p) {
     }
 }
 
+/* Merge a chain of events, sorted by time and linked through next, into */
+/* the event list.  Like insertevent(), each event goes after those      */
+/* already due at the same time, so the burst keeps its send order.      */
+void simulator::mergeevents(struct event *chain) {
+    struct event *q = evlist, *qold = nullptr;
+
+    while (chain != nullptr) {
+        struct event *p = chain;
+        chain = chain->next;
+
+        TRACE << "MERGEEVENTS (" << getSimulatorClock() << "): Inserting " << EVENT_NAMES[p->evtype]
+            << " type event to happen at " << units(p->evtime) << ENDL;
+
+        for (; q != nullptr && p->evtime >= q->evtime; q = q->next)
+            qold = q;
+
+        p->prev = qold;
+        p->next = q;
+        if (qold == nullptr)
+            evlist = p;
+        else
+            qold->next = p;
+        if (q != nullptr)
+            q->prev = p;
+        qold = p;
+    }
+}
+
 void simulator::printevlist() {
     struct event *q;
     printf("--------------\nEvent List Follows:\n");
     for (q = evlist; q != nullptr; q = q->next) {
-        printf("Event time: %f, type: %d entity: %d\n", q->evtime, q->evtype, q->eventity);
+        printf("Event time: %f, type: %d entity: %d\n", units(q->evtime), q->evtype, q->eventity);
     }
     printf("--------------\n");
 }
@@ -257,7 +502,7 @@ void simulator:: reportPacketsInFlight(int AorB) {
             sequenceNumbers.push_back(q->pktptr->seqnum);
         }
     }
-    std::cout << "TOLAYER3 (" << kr_time << "): "
+    std::cout << "TOLAYER3 (" << getSimulatorClock() << "): "
         << sequenceNumbers.size() << " packets in flight to side " << SIDE_NAMES[AorB] << " (";
     for (auto sn : sequenceNumbers) {
         std::cout << sn << ", ";
@@ -269,13 +514,13 @@ void simulator:: reportPacketsInFlight(int AorB) {
 /********************** Student-callable ROUTINES ***********************/
 
 /* called by students routine to cancel a previously-started timer */
-void simulator::stop_timer(int AorB) {
+void simulator::stop_timer(int AorB, int timer) {
 
-    DEBUG << "STOPTIMER (" << kr_time << "): stopping timer on side " << SIDE_NAMES[AorB] << ENDL;
+    DEBUG << "STOPTIMER (" << getSimulatorClock() << "): stopping " << EVENT_NAMES[timer] << " timer on side " << SIDE_NAMES[AorB] << ENDL;
 
     /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
     for (struct event *q = evlist; q != nullptr; q = q->next)
-        if ((q->evtype == TIMER_INTERRUPT && q->eventity == AorB)) {
+        if ((q->evtype == timer && q->eventity == AorB)) {
             /* remove this event */
             if (q->next == nullptr && q->prev == nullptr)
                 evlist = nullptr;         /* remove first and only event on list */
@@ -288,51 +533,86 @@ void simulator::stop_timer(int AorB) {
                 q->next->prev = q->prev;
                 q->prev->next = q->next;
             }
-            TRACE << "STOPTIMER (" << kr_time << "): removing timer scheduled for " << q->evtime << ENDL;
+            TRACE << "STOPTIMER (" << getSimulatorClock() << "): removing timer scheduled for " << units(q->evtime) << ENDL;
             free(q);
             return;
         }
-    WARNING << "STOPTIMER (" << kr_time << "): WARNING: unable to cancel your timer. It wasn't running." << ENDL;
+    WARNING << "STOPTIMER (" << getSimulatorClock() << "): WARNING: unable to cancel your timer. It wasn't running." << ENDL;
 }
 
 
-void simulator::start_timer(int AorB, float increment) {
+void simulator::start_timer(int AorB, float increment, int timer) {
+    start_timer_ticks(AorB, ticks(increment), timer);
+}
+
+
+void simulator::start_timer_ticks(int AorB, simtime increment, int timer) {
     struct event *q;
     struct event *evptr;
 
-    DEBUG << "STARTTIMER (" << kr_time << "): starting timer to expire at " << kr_time + increment << ENDL;
+    /* a timer in the past (or past the end of time) would run the clock backwards */
+    if ((increment < 0) || (increment > std::numeric_limits<simtime>::max() - kr_time)) {
+        FATAL << "STARTTIMER (" << getSimulatorClock() << "): invalid timer increment of " << increment << " ticks." << ENDL;
+        exit(-1);
+    }
+
+    DEBUG << "STARTTIMER (" << getSimulatorClock() << "): starting timer to expire at " << units(kr_time + increment) << ENDL;
 
     /* be nice: check to see if timer is already started, if so, then  warn */
     /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
     for (q = evlist; q != nullptr; q = q->next)
-        if ((q->evtype == TIMER_INTERRUPT) && (q->eventity == AorB)) {
-            WARNING << "STARTTIMER (" << kr_time << "): WARNING: unable to start timer, there is one already running, "
-            << "scheduled to go off at " << q->evtime << ENDL;
+        if ((q->evtype == timer) && (q->eventity == AorB)) {
+            WARNING << "STARTTIMER (" << getSimulatorClock() << "): WARNING: unable to start timer, there is one already running, "
+            << "scheduled to go off at " << units(q->evtime) << ENDL;
             return;
         }
 
     /* create future event for when timer goes off */
     evptr = (struct event *) malloc(sizeof(struct event));
     evptr->evtime = kr_time + increment;
-    evptr->evtype = TIMER_INTERRUPT;
+    evptr->evtype = timer;
     evptr->eventity = AorB;
     insertevent(evptr);
 }
 
 
 /************************** TOLAYER3 ***************/
-void simulator::udt_send(int AorB, struct pkt packet) {
+
+/* arrival time of the last packet currently in the medium on its way to AorB */
+simtime simulator::channel_tail(int AorB) {
+    simtime lastime = kr_time;
+    if (net != nullptr)             /* each hop keeps track of its own tail */
+        return lastime;
+    for (struct event *q = evlist; q != nullptr; q = q->next)
+        if ((q->evtype == FROM_LAYER3 && q->eventity == AorB))
+            lastime = q->evtime;
+    return lastime;
+}
+
+
+/* Push one packet into the medium.  Returns the arrival event, not yet on */
+/* the event list, or nullptr if the packet was lost.  lastime is the      */
+/* arrival time of the packet ahead of this one and is updated.           */
+struct event *simulator::transmit(int AorB, const struct pkt &packet, simtime &lastime) {
     struct pkt *mypktptr;
-    struct event *evptr, *q;
-    double lastime, x;
+    struct event *evptr;
+    double x;
 
     ntolayer3++;
+    packetsSent[AorB]++;
 
     /* simulate losses: */
-    if (jimsrand() < lossprob) {
+    bool lost = channels[AorB]->lose();
+    if (lost && !lastLost[AorB])
+        lossBursts[AorB]++;
+    lastLost[AorB] = lost;
+    if (lost) {
         nlost++;
+        lostBy[AorB]++;
         TRACE << "TOLAYER3: Loosing packet: " << packet << ENDL;
-        return;
+        if (capture != nullptr)
+            capture->record(getSimulatorClock(), AorB, packet, PCAP_OUTBOUND, "lost");
+        return nullptr;
     }
 
     /* make a copy of the packet student just gave me since he/she may decide */
@@ -341,51 +621,159 @@ void simulator::udt_send(int AorB, struct pkt packet) {
     mypktptr->seqnum = packet.seqnum;
     mypktptr->acknum = packet.acknum;
     mypktptr->checksum = packet.checksum;
-    for (int i = 0; i < 20; i++)
-        mypktptr->payload[i] = packet.payload[i];
+    mypktptr->data = packet.data;
+    mypktptr->length = std::min(std::max(packet.length, 0), (packet.data != nullptr) ? MAX_SEGMENT : MAX_PAYLOAD);
+    if (packet.data == nullptr)
+        memcpy(mypktptr->payload, packet.payload, mypktptr->length);
 
 
     /* create future event for arrival of packet at the other side */
-    evptr = (struct event *) malloc(sizeof(struct event));
-    evptr->evtype = FROM_LAYER3;   /* packet will pop out from layer3 */
-    evptr->eventity = (AorB + 1) % 2; /* event occurs at other entity */
-    evptr->pktptr = mypktptr;       /* save ptr to my copy of packet */
-
-
-    /* finally, compute the arrival time of packet at the other end.
-     medium can not reorder, so make sure packet arrives between 1 and 10
-     time units after the latest arrival time of packets
-     currently in the medium on their way to the destination */
-    lastime = kr_time;
-    for (q = evlist; q != nullptr; q = q->next)
-        if ((q->evtype == FROM_LAYER3 && q->eventity == evptr->eventity))
-            lastime = q->evtime;
-    evptr->evtime = lastime + 1 + 9 * jimsrand();
+    if (net == nullptr) {
+        evptr = (struct event *) malloc(sizeof(struct event));
+        evptr->evtype = FROM_LAYER3;   /* packet will pop out from layer3 */
+        evptr->eventity = (AorB + 1) % 2; /* event occurs at other entity */
+
+
+        /* finally, compute the arrival time of packet at the other end.
+         medium can not reorder, so make sure packet arrives between 1 and 10
+         time units after the latest arrival time of packets
+         currently in the medium on their way to the destination */
+        evptr->evtime = lastime + ticks(1 + 9 * jimsrand());
+        lastime = evptr->evtime;
+    }
 
 
     /* simulate corruption: */
-    if (jimsrand() < corruptprob) {
+    bool corrupted = false;
+    if (channels[AorB]->corrupt()) {
         ncorrupt++;
-        if ((x = jimsrand()) < .75)
-            std::fill(mypktptr->payload, mypktptr->payload + sizeof(mypktptr->payload), (rand()  % 93) + 33  );
-        else if (x < .875)
+        corruptedBy[AorB]++;
+        corrupted = true;
+        if ((x = jimsrand()) < .75) {
+            /* bytes outside the packet belong to the sender, corrupt a copy */
+            /* kept at the end of the packet so it is freed along with it    */
+            if (mypktptr->data != nullptr) {
+                mypktptr = (struct pkt *) realloc(mypktptr, sizeof(struct pkt) + mypktptr->length);
+                memcpy(mypktptr + 1, mypktptr->data, mypktptr->length);
+                mypktptr->data = (const char *) (mypktptr + 1);
+            }
+            char *bytes = (char *) pkt_bytes(*mypktptr);
+            std::fill(bytes, bytes + mypktptr->length, (rand()  % 93) + 33  );
+        } else if (x < .875)
             mypktptr->seqnum =  rand() ;
         else
             mypktptr->acknum = rand();
-        TRACE << "TOLAYER3 (" << kr_time << ") Corrupting packet " << packet << " as " << *mypktptr << ENDL;
+        TRACE << "TOLAYER3 (" << getSimulatorClock() << ") Corrupting packet " << packet << " as " << *mypktptr << ENDL;
     }
 
+    if (capture != nullptr)
+        capture->record(getSimulatorClock(), AorB, packet, PCAP_OUTBOUND, corrupted ? "corrupted" : nullptr);
 
-    DEBUG << "TOLAYER3 (" << kr_time << "): Scheduling " << packet
+    /* with a topology the packet starts out across the first hop instead */
+    if (net != nullptr)
+        return forward((AorB + 1) % 2, 0, mypktptr);
+
+    evptr->pktptr = mypktptr;       /* save ptr to my copy of packet */
+    DEBUG << "TOLAYER3 (" << getSimulatorClock() << "): Scheduling " << packet
         << " to arrive on side " << SIDE_NAMES[(AorB + 1) % 2]
-        << " at " << evptr->evtime << "." << ENDL;
-    insertevent(evptr);
+        << " at " << units(evptr->evtime) << "." << ENDL;
+    return evptr;
+}
+
+
+/* Put a packet heading for side AorB on the given hop of its route.  */
+/* Returns the event for its arrival at the far end of the hop, or    */
+/* nullptr if the packet was dropped there.                           */
+struct event *simulator::forward(int AorB, int hop, struct pkt *mypktptr) {
+    struct channel &c = net->links[net->routes[AorB][hop]];
+
+    if (c.queued >= c.queuelimit) {
+        c.dropped++;
+        TRACE << "FORWARD (" << getSimulatorClock() << "): queue full at " << net->nodes[c.from]
+            << ", dropping " << *mypktptr << ENDL;
+        if (capture != nullptr)
+            capture->record(getSimulatorClock(), (AorB + 1) % 2, *mypktptr, 0, ("dropped at " + net->nodes[c.from]).c_str());
+        free(mypktptr);
+        return nullptr;
+    }
+    if (jimsrand() < c.lossprob) {
+        c.lost++;
+        TRACE << "FORWARD (" << getSimulatorClock() << "): Loosing packet between " << net->nodes[c.from]
+            << " and " << net->nodes[c.to] << ": " << *mypktptr << ENDL;
+        if (capture != nullptr)
+            capture->record(getSimulatorClock(), (AorB + 1) % 2, *mypktptr, 0,
+                            ("lost between " + net->nodes[c.from] + " and " + net->nodes[c.to]).c_str());
+        free(mypktptr);
+        return nullptr;
+    }
+
+    struct event *evptr = (struct event *) malloc(sizeof(struct event));
+    evptr->evtype = (hop + 1 == (int) net->routes[AorB].size()) ? FROM_LAYER3 : AT_ROUTER;
+    evptr->eventity = AorB;
+    evptr->pktptr = mypktptr;
+    evptr->hop = hop;
+
+    /* links are FIFO: the packet leaves after everything already queued on it */
+    evptr->evtime = std::max(kr_time, c.lastdeparture)
+        + ticks(c.mindelay + (c.maxdelay - c.mindelay) * jimsrand());
+    c.lastdeparture = evptr->evtime;
+    c.queued++;
+    c.sent++;
+    c.totaldelay += units(evptr->evtime - kr_time);
+
+    DEBUG << "FORWARD (" << getSimulatorClock() << "): " << *mypktptr << " leaves " << net->nodes[c.from]
+        << ", arrives at " << net->nodes[c.to] << " at " << units(evptr->evtime) << "." << ENDL;
+    return evptr;
+}
+
+
+void simulator::udt_send(int AorB, struct pkt packet) {
+    simtime lastime = channel_tail((AorB + 1) % 2);
+
+    struct event *evptr = transmit(AorB, packet, lastime);
+    if (evptr != nullptr)
+        insertevent(evptr);
 
     // if ((BIDIRECTIONAL) || (AorB == A))
     //    reportPacketsInFlight((AorB + 1) % 2);
 }
 
 
+/* Send count packets back to back.  Equivalent to calling udt_send() on   */
+/* each of them in turn, but the channel tail is found once and the        */
+/* arrivals, which are already in time order, are merged into the event    */
+/* list in a single pass.                                                  */
+void simulator::udt_send_burst(int AorB, const struct pkt *packets, int count) {
+#ifdef NO_SEND_BURST
+    /* reference path for make check: the same packets one at a time */
+    for (int i = 0; i < count; i++)
+        udt_send(AorB, packets[i]);
+    return;
+#endif
+    /* most resends after an ack have nothing to send */
+    if (count == 0)
+        return;
+
+    struct event *head = nullptr, *tail = nullptr;
+    simtime lastime = channel_tail((AorB + 1) % 2);
+
+    for (int i = 0; i < count; i++) {
+        struct event *evptr = transmit(AorB, packets[i], lastime);
+        if (evptr == nullptr)
+            continue;
+        evptr->next = nullptr;
+        evptr->prev = tail;
+        if (tail == nullptr)
+            head = evptr;
+        else
+            tail->next = evptr;
+        tail = evptr;
+    }
+
+    mergeevents(head);
+}
+
+
 void simulator::deliver_data(int AorB, struct msg message) {
 
 
@@ -401,13 +789,80 @@ void simulator::deliver_data(int AorB, struct msg message) {
     
 
     if (validMessage)
-      DEBUG << "deliver_data (" << kr_time << "): Data received at application layer on side " << SIDE_NAMES[AorB] << ", (" << message << ")." << ENDL;
+      DEBUG << "deliver_data (" << getSimulatorClock() << "): Data received at application layer on side " << SIDE_NAMES[AorB] << ", (" << message << ")." << ENDL;
       
+    delivered(AorB, sizeof(message.data));
+}
+
+
+void simulator::deliver_segment(int AorB, const char *data, int length) {
+    if (transfer == nullptr) {
+      WARNING << "Segment received by application on side " << SIDE_NAMES[AorB] << " without a file transfer" << ENDL;
+      return;
+    }
+    DEBUG << "deliver_segment (" << getSimulatorClock() << "): " << length << " bytes received at application layer on side " << SIDE_NAMES[AorB] << ENDL;
+    transfer->receive(data, length);
+    delivered(AorB, length);
+}
+
+
+/* Bookkeeping for every message or segment handed to an application. */
+void simulator::delivered(int AorB, int bytes) {
+    /* messages from A arrive in the order they were accepted */
+    simtime delay = 0;
+    if ((AorB == B) && (messagesReceived[B] < (int) latencies.size())) {
+      delay = kr_time - latencies[messagesReceived[B]];
+      latencies[messagesReceived[B]] = delay;
+    }
+
     messagesReceived[AorB]++;
-    
-    
+    bytesReceived[AorB] += bytes;
+
+    if ((AorB == B) && (precision > 0))
+      collect_batch(delay, bytes);
+}
+
+/* Adds a delivered message to the current batch.  Once a batch is full   */
+/* its goodput and mean latency become one sample each, and the run stops */
+/* when both confidence intervals are narrow enough.                      */
+void simulator::collect_batch(simtime delay, int bytes) {
+    if (messagesReceived[B] <= warmup) {
+        batchStart = kr_time;
+        return;
+    }
+
+    batchCount++;
+    batchLatency += delay;
+    batchBytes += bytes;
+    /* a batch delivered in a single tick has no goodput, so keep it open */
+    /* until the clock moves on and both estimates get the same batches  */
+    if ((batchCount < batchSize) || (kr_time == batchStart))
+        return;
+
+    goodput.add(batchBytes / units(kr_time - batchStart));
+    latency.add(units(batchLatency) / batchCount);
+    batchCount = 0;
+    batchBytes = 0;
+    batchLatency = 0;
+    batchStart = kr_time;
+
+    DEBUG << "COLLECT_BATCH (" << getSimulatorClock() << "): batch " << latency.batches()
+        << ", goodput " << goodput.estimate() << " +/- " << goodput.halfwidth()
+        << ", latency " << latency.estimate() << " +/- " << latency.halfwidth() << ENDL;
+
+    if ((goodput.batches() >= MIN_BATCHES)
+        && (goodput.halfwidth() <= precision * goodput.estimate())
+        && (latency.halfwidth() <= precision * latency.estimate())) {
+        INFO << "COLLECT_BATCH (" << getSimulatorClock() << "): converged after " << goodput.batches() << " batches" << ENDL;
+        converged = true;
+    }
 }
 
+
 double simulator::getSimulatorClock() {
+    return(units(kr_time));
+}
+
+simtime simulator::getSimulatorTicks() {
     return(kr_time);
 }
@@ -24,14 +24,27 @@ struct msg {
 
 /* a packet is the data unit passed from layer 4 (students code) to layer */
 /* 3 (teachers code).  Note the pre-defined packet structure, which all   */
-/* students must follow. */
+/* students must follow.  Only the first length bytes of the payload are  */
+/* carried by the network, which lets one packet hold several messages.   */
+/* A packet can instead point at up to MAX_SEGMENT bytes kept outside it,  */
+/* such as a segment of a mapped file, with data.  The network then passes */
+/* the pointer along rather than copying the bytes, and payload is unused. */
+#define MAX_PAYLOAD 240
+#define MAX_SEGMENT 65000
 struct pkt {
     int seqnum;
     int acknum;
     int checksum;
-    char payload[20];
+    int length;
+    const char *data;
+    char payload[MAX_PAYLOAD];
 };
 
+/* the bytes a packet carries, wherever they are */
+inline const char *pkt_bytes(const struct pkt &packet) {
+    return (packet.data != nullptr) ? packet.data : packet.payload;
+}
+
 
 /*****************************************************************
 ***************** NETWORK EMULATION CODE STARTS BELOW ***********
@@ -49,11 +62,17 @@ the emulator, you're welcome to look at the code - but again, you should not hav
 to, and you defeinitely should not have to modify
 ******************************************************************/
 
+/* Simulated time is kept as a whole number of ticks, so event times    */
+/* compare exactly and long runs don't lose precision.  There are        */
+/* simulator::resolution ticks per time unit.                            */
+typedef int64_t simtime;
+
 struct event {
-    double evtime;           /* event time */
+    simtime evtime;          /* event time, in ticks */
     int evtype;             /* event type code */
     int eventity;           /* entity where event occurs */
     struct pkt *pktptr;     /* ptr to packet (if any) assoc w/ this event */
+    int hop;                /* route hop the packet is crossing (topology only) */
     struct event *prev;
     struct event *next;
 };
@@ -62,39 +81,94 @@ struct event {
 #define  TIMER_INTERRUPT 0
 #define  FROM_LAYER5     1
 #define  FROM_LAYER3     2
-static const char *EVENT_NAMES[] = {"TIMER_INTERRUPT", "FROM_LAYER5", "FROM_LAYER3"};
+#define  AT_ROUTER       3
+#define  FLUSH_INTERRUPT 4
+static const char *EVENT_NAMES[] = {"TIMER_INTERRUPT", "FROM_LAYER5", "FROM_LAYER3", "AT_ROUTER", "FLUSH_INTERRUPT"};
 
 #define   A    0
 #define   B    1
 static const char *SIDE_NAMES[] = {"A", "B"};
 
+class traffic_model;
+class loss_model;
+class topology;
+class pcap_writer;
+class file_transfer;
+
 class simulator {
 private:
     long nsim;                /* number of messages from 5 to 4 so far */
     long nsimmax;             /* number of msgs to generate, then stop */
-    double kr_time;
+    simtime kr_time;
     double lossprob;          /* probability that a packet is dropped  */
     double corruptprob;       /* probability that one bit is packet is flipped */
     double lambda;            /* arrival rate of messages from layer 5 */
     int ntolayer3;            /* number sent into layer 3 */
+    long packetsSent[2];      /* number sent into layer 3 by each side */
     int nlost;                /* number lost in media */
     int ncorrupt;             /* number corrupted by media*/
+    loss_model *channels[2];  /* fate of the packets sent by each side */
+    long lostBy[2];           /* packets each side sent that were lost */
+    long corruptedBy[2];      /* and that were corrupted */
+    long lossBursts[2];       /* runs of consecutive losses */
+    bool lastLost[2];         /* the last packet the side sent was lost */
     struct event *evlist;     /* the event list */
     int messagesReceived[2];   /* The number of messages received by the application */
+    long long bytesReceived[2]; /* The number of bytes in them */
+    std::vector<simtime> latencies; /* A's messages: time accepted, then time to deliver */
+
+    /* run until converged: batch means of goodput and latency at side B */
+    double precision;         /* target CI half-width as a fraction of the estimate, 0 = off */
+    long warmup;              /* delivered msgs discarded before the first batch */
+    long batchSize;           /* delivered msgs per batch */
+    long batchCount;          /* msgs in the current batch so far */
+    simtime batchStart;       /* time the current batch started */
+    simtime batchLatency;     /* total latency of the msgs in the current batch */
+    long batchBytes;          /* bytes delivered in the current batch */
+    batch_means goodput;
+    batch_means latency;
+    bool converged;
+    traffic_model *traffic;   /* decides when layer 5 hands down the next message */
+    bool sourceBlocked;       /* saturating source is waiting for the window to open */
+    topology *net;            /* routers between A and B, nullptr for a direct link */
+    long ntimeouts;           /* number of timer interrupts */
+    pcap_writer *capture;     /* where to record traffic, nullptr if not capturing */
+    file_transfer *transfer;  /* file sent from A to B, nullptr to send generated msgs */
+    double cpuSeconds;        /* processor time taken by the main loop */
 
 
-    double jimsrand();
     void generate_next_arrival();
     void insertevent(struct event *p);
+    void mergeevents(struct event *chain);
+    simtime channel_tail(int AorB);
+    struct event *transmit(int AorB, const struct pkt &packet, simtime &lastime);
+    struct event *forward(int AorB, int hop, struct pkt *mypktptr);
     void reportPacketsInFlight(int AorB);
     void printevlist();
+    void report();
+    void delivered(int AorB, int bytes);
+    void collect_batch(simtime delay, int bytes);
 
 public:
     simulator(long n, double l,  double c,  double t);
+    static double jimsrand();
+    static int64_t resolution;      /* ticks per time unit */
+    static simtime ticks(double units) { return llround(units * resolution); }
+    static double units(simtime t) { return (double) t / resolution; }
+    void set_traffic(const std::string &spec);
+    void set_loss_model(int AorB, const std::string &spec);
+    void set_topology(const std::string &filename);
+    void set_capture(const std::string &filename);
+    void set_convergence(double p, long w, long b);
+    void set_file_transfer(const std::string &input, int mss, const std::string &output);
     void go();
     double getSimulatorClock();
-    void stop_timer(int AorB);
-    void start_timer(int AorB, float increment);
+    simtime getSimulatorTicks();
+    void stop_timer(int AorB, int timer = TIMER_INTERRUPT);
+    void start_timer(int AorB, float increment, int timer = TIMER_INTERRUPT);
+    void start_timer_ticks(int AorB, simtime increment, int timer = TIMER_INTERRUPT);
     void udt_send(int AorB, struct pkt packet);
+    void udt_send_burst(int AorB, const struct pkt *packets, int count);
     void deliver_data(int AorB, struct msg message);
+    void deliver_segment(int AorB, const char *data, int length);
 };
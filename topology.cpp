@@ -0,0 +1,134 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Loading and reporting for multi-hop topologies.  The packet forwarding itself is done
+// * by the simulator, see simulator::forward().
+// ******************************************************************************************
+
+topology::topology(const std::string &filename) {
+    nodes.push_back("A");
+    nodes.push_back("B");
+
+    std::ifstream in(filename);
+    if (!in) {
+        FATAL << "Unable to open topology " << filename << "." << ENDL;
+        exit(-1);
+    }
+
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        lineno++;
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword) || keyword[0] == '#')
+            continue;
+
+        if (keyword == "node") {
+            std::string name;
+            if (!(words >> name) || find_node(name) != -1) {
+                FATAL << filename << ":" << lineno << ": missing or duplicate node name." << ENDL;
+                exit(-1);
+            }
+            nodes.push_back(name);
+
+        } else if (keyword == "link") {
+            std::string a, b;
+            struct channel l { };
+            if (!(words >> a >> b >> l.mindelay >> l.maxdelay >> l.lossprob >> l.queuelimit)) {
+                FATAL << filename << ":" << lineno << ": expected link <name> <name> <min delay> <max delay> <loss prob> <queue limit>." << ENDL;
+                exit(-1);
+            }
+            l.from = find_node(a);
+            l.to = find_node(b);
+            if ((l.from == -1) || (l.to == -1) || (l.from == l.to)) {
+                FATAL << filename << ":" << lineno << ": link between unknown nodes " << a << " and " << b << "." << ENDL;
+                exit(-1);
+            }
+            if ((l.mindelay < 0) || (l.maxdelay < l.mindelay) || (l.lossprob < 0) || (l.lossprob > 1) || (l.queuelimit <= 0)) {
+                FATAL << filename << ":" << lineno << ": invalid link parameters." << ENDL;
+                exit(-1);
+            }
+            /* links are full duplex, one FIFO per direction */
+            links.push_back(l);
+            std::swap(l.from, l.to);
+            links.push_back(l);
+
+        } else if (keyword == "route") {
+            std::vector<int> path;
+            std::string name;
+            while (words >> name) {
+                int node = find_node(name);
+                if (node == -1) {
+                    FATAL << filename << ":" << lineno << ": route through unknown node " << name << "." << ENDL;
+                    exit(-1);
+                }
+                path.push_back(node);
+            }
+            if ((path.size() < 2) || (path.front() > B) || (path.back() > B) || (path.front() == path.back())) {
+                FATAL << filename << ":" << lineno << ": a route must go from A to B or from B to A." << ENDL;
+                exit(-1);
+            }
+            int dest = path.back();
+            routes[dest].clear();
+            for (size_t i = 1; i < path.size(); i++) {
+                int l = find_link(path[i - 1], path[i]);
+                if (l == -1) {
+                    FATAL << filename << ":" << lineno << ": no link from " << nodes[path[i - 1]] << " to " << nodes[path[i]] << "." << ENDL;
+                    exit(-1);
+                }
+                routes[dest].push_back(l);
+            }
+
+        } else {
+            FATAL << filename << ":" << lineno << ": unknown keyword " << keyword << "." << ENDL;
+            exit(-1);
+        }
+    }
+
+    if (routes[B].empty()) {
+        FATAL << "Topology " << filename << " has no route from A to B." << ENDL;
+        exit(-1);
+    }
+
+    /* without an explicit route back, acks retrace the forward path */
+    if (routes[A].empty())
+        for (auto l = routes[B].rbegin(); l != routes[B].rend(); ++l)
+            routes[A].push_back(find_link(links[*l].to, links[*l].from));
+
+    INFO << "Loaded topology " << filename << ": " << nodes.size() << " nodes, "
+        << links.size() / 2 << " links, " << routes[B].size() << " hops from A to B, "
+        << routes[A].size() << " hops from B to A" << ENDL;
+}
+
+
+int topology::find_node(const std::string &name) {
+    for (size_t i = 0; i < nodes.size(); i++)
+        if (nodes[i] == name)
+            return i;
+    return -1;
+}
+
+
+int topology::find_link(int from, int to) {
+    for (size_t i = 0; i < links.size(); i++)
+        if ((links[i].from == from) && (links[i].to == to))
+            return i;
+    return -1;
+}
+
+
+void topology::report(std::ostream &os) {
+    os << "Per hop statistics:" << std::endl;
+    for (int dest : {B, A}) {
+        os << "  toward " << SIDE_NAMES[dest] << std::endl;
+        for (int l : routes[dest]) {
+            struct channel &c = links[l];
+            os << "    " << nodes[c.from] << " -> " << nodes[c.to]
+                << ": sent " << c.sent
+                << ", queue drops " << c.dropped
+                << ", lost " << c.lost
+                << ", avg delay " << (c.sent ? c.totaldelay / c.sent : 0.0) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+// ***********************************************************
+// * Multi-hop network topology.
+// *
+// * Sides A and B are connected by a chain of store-and-forward
+// * routers.  Each link direction is a FIFO with its own delay,
+// * loss probability and queue limit.  The topology is loaded from
+// * a text file:
+// *
+// *   node  <name>
+// *   link  <name> <name> <min delay> <max delay> <loss prob> <queue limit>
+// *   route A <name> ... B
+// *   route B <name> ... A      (optional, default is the reverse of A->B)
+// *
+// * Nodes A and B always exist.  Blank lines and lines starting
+// * with '#' are ignored.
+// ***********************************************************
+
+struct channel {
+    int from;                 /* node the packet leaves */
+    int to;                   /* node the packet arrives at */
+    double mindelay;          /* per packet delay is uniform on [mindelay,maxdelay] */
+    double maxdelay;
+    double lossprob;          /* probability that a packet is dropped on this hop */
+    int queuelimit;           /* packets allowed on the link, waiting or in transit */
+
+    int queued;               /* packets currently on the link */
+    simtime lastdeparture;    /* time the last packet leaves the link, in ticks */
+
+    long sent;                /* packets that made it across */
+    long dropped;             /* packets refused because the queue was full */
+    long lost;                /* packets lost on the link */
+    double totaldelay;        /* queueing plus transit time of packets sent */
+};
+
+class topology {
+public:
+    std::vector<std::string> nodes;
+    std::vector<struct channel> links;
+    std::vector<int> routes[2];   /* links taken by a packet heading to side A or B */
+
+    explicit topology(const std::string &filename);
+    int find_node(const std::string &name);
+    int find_link(int from, int to);
+    void report(std::ostream &os);
+};
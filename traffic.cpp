@@ -0,0 +1,98 @@
+#include "includes.h"
+
+// ******************************************************************************************
+// * Application traffic models used by the simulator to generate FROM_LAYER5 events.
+// ******************************************************************************************
+
+/* Exponentially distributed value with the given mean. */
+static double exponential(double mean) {
+    double u;
+    do {
+        u = simulator::jimsrand();
+    } while (u <= 0.0);
+    return -mean * log(u);
+}
+
+double uniform_traffic::next_arrival(double now) {
+    /* Delay will be uniform on [0,2*lambda] */
+    return now + (lambda * simulator::jimsrand() * 2);
+}
+
+double poisson_traffic::next_arrival(double now) {
+    return now + exponential(lambda);
+}
+
+onoff_traffic::onoff_traffic(double l, double on, double off) {
+    lambda = l;
+    meanOn = on;
+    meanOff = off;
+    onEnds = exponential(meanOn);
+}
+
+double onoff_traffic::next_arrival(double now) {
+    double t = now + exponential(lambda);
+
+    /* Skip over off periods until the arrival lands inside a burst. */
+    while (t > onEnds) {
+        double onStarts = std::max(now, onEnds) + exponential(meanOff);
+        onEnds = onStarts + exponential(meanOn);
+        t = onStarts + exponential(lambda);
+    }
+    return t;
+}
+
+trace_traffic::trace_traffic(const std::string &filename) {
+    next = 0;
+
+    std::ifstream in(filename);
+    if (!in) {
+        FATAL << "Unable to open traffic trace " << filename << "." << ENDL;
+        exit(-1);
+    }
+
+    std::string line;
+    double last = 0.0;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        double t = std::strtod(line.c_str(), nullptr);
+        if (t < last) {
+            FATAL << "Traffic trace " << filename << " is not sorted by time (" << t << " after " << last << ")." << ENDL;
+            exit(-1);
+        }
+        arrivals.push_back(t);
+        last = t;
+    }
+    INFO << "Loaded " << arrivals.size() << " arrivals from traffic trace " << filename << ENDL;
+}
+
+double trace_traffic::next_arrival(double now) {
+    if (next >= arrivals.size())
+        return -1.0;
+    return std::max(now, arrivals[next++]);
+}
+
+traffic_model *make_traffic_model(const std::string &spec, double lambda) {
+    std::string kind = spec.substr(0, spec.find(':'));
+    std::string args = (spec.find(':') == std::string::npos) ? "" : spec.substr(spec.find(':') + 1);
+
+    if (kind == "uniform")
+        return new uniform_traffic(lambda);
+    if (kind == "poisson")
+        return new poisson_traffic(lambda);
+    if (kind == "bulk")
+        return new bulk_traffic();
+    if (kind == "trace" && !args.empty())
+        return new trace_traffic(args);
+    if (kind == "onoff") {
+        char *end;
+        double on = std::strtod(args.c_str(), &end);
+        if (*end != ':')
+            return nullptr;
+        double off = std::strtod(end + 1, nullptr);
+        if (on <= 0 || off < 0)
+            return nullptr;
+        return new onoff_traffic(lambda, on, off);
+    }
+    return nullptr;
+}
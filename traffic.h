@@ -0,0 +1,81 @@
+// ***********************************************************
+// * Application traffic models.
+// *
+// * A traffic model decides when the next message is handed from
+// * layer 5 to layer 4.  The simulator asks for the time of the
+// * next arrival every time it schedules a FROM_LAYER5 event.
+// ***********************************************************
+
+class traffic_model {
+public:
+    virtual ~traffic_model() = default;
+
+    // Absolute simulated time of the next arrival, or a negative
+    // value if the source has nothing more to offer.
+    virtual double next_arrival(double now) = 0;
+
+    // A saturating source always has data: it offers a message as soon
+    // as the previous one is accepted, and again whenever the sender's
+    // window may have opened after being refused.
+    virtual bool saturating() const { return false; }
+
+    virtual const char *name() const = 0;
+};
+
+/* Uniform inter-arrival times on [0,2*lambda], the original model. */
+class uniform_traffic : public traffic_model {
+private:
+    double lambda;
+public:
+    explicit uniform_traffic(double l) : lambda(l) {}
+    double next_arrival(double now) override;
+    const char *name() const override { return "uniform"; }
+};
+
+/* Exponential inter-arrival times with mean lambda. */
+class poisson_traffic : public traffic_model {
+private:
+    double lambda;
+public:
+    explicit poisson_traffic(double l) : lambda(l) {}
+    double next_arrival(double now) override;
+    const char *name() const override { return "poisson"; }
+};
+
+/* Exponentially distributed on and off periods.  While on, arrivals */
+/* are Poisson with mean gap lambda; while off nothing is offered.    */
+class onoff_traffic : public traffic_model {
+private:
+    double lambda;
+    double meanOn;
+    double meanOff;
+    double onEnds;            /* end of the current (or last) on period */
+public:
+    onoff_traffic(double l, double on, double off);
+    double next_arrival(double now) override;
+    const char *name() const override { return "onoff"; }
+};
+
+/* Always backlogged: offers data whenever the window opens. */
+class bulk_traffic : public traffic_model {
+public:
+    double next_arrival(double now) override { return now; }
+    bool saturating() const override { return true; }
+    const char *name() const override { return "bulk"; }
+};
+
+/* Arrival times replayed from a file, one absolute time per line. */
+class trace_traffic : public traffic_model {
+private:
+    std::vector<double> arrivals;
+    size_t next;
+public:
+    explicit trace_traffic(const std::string &filename);
+    double next_arrival(double now) override;
+    const char *name() const override { return "trace"; }
+};
+
+// Builds a model from a command line description:
+//   uniform | poisson | onoff:<mean on>:<mean off> | bulk | trace:<file>
+// Returns nullptr if the description can't be understood.
+traffic_model *make_traffic_model(const std::string &spec, double lambda);